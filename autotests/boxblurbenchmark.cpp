@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// own
+#include "breezeboxblur_p.h"
+
+// Qt
+#include <QByteArray>
+#include <QTest>
+#include <QThread>
+
+#include <cstring>
+
+using namespace Breeze;
+
+/**
+ * Compare the blur of a shadow quadrant on one thread and on several threads.
+ *
+ * The sizes go from the quadrants of the smallest presets at scale 1 to the
+ * ones of the largest custom radius at scale 3. The size from which the split
+ * wins is where ParallelBlurThreshold belongs.
+ *
+ * Run with -tickcounter or -iterations to get stable numbers.
+ **/
+class BoxBlurBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkBlur_data();
+    void benchmarkBlur();
+};
+
+void BoxBlurBenchmark::benchmarkBlur_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("threadCount");
+
+    const int idealThreadCount = QThread::idealThreadCount();
+    for (int size : {64, 96, 128, 181, 256, 362, 512, 724, 1086}) {
+        QTest::addRow("%dx%d, 1 thread", size, size) << size << 1;
+        QTest::addRow("%dx%d, %d threads", size, size, idealThreadCount) << size << idealThreadCount;
+    }
+}
+
+void BoxBlurBenchmark::benchmarkBlur()
+{
+    QFETCH(int, size);
+    QFETCH(int, threadCount);
+
+    // A box with a sharp edge, like the rasterized box of a shadow.
+    QByteArray mask(size * size, char(0));
+    for (int y = size / 3; y < size; ++y) {
+        memset(mask.data() + y * size + size / 3, 255, size - size / 3);
+    }
+
+    QByteArray image;
+    QBENCHMARK {
+        image = mask;
+        boxBlurAlpha(reinterpret_cast<uint8_t *>(image.data()), size, size, 1, size, 48, threadCount);
+    }
+}
+
+QTEST_APPLESS_MAIN(BoxBlurBenchmark)
+
+#include "boxblurbenchmark.moc"
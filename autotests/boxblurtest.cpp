@@ -0,0 +1,233 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// own
+#include "breezeboxblur_p.h"
+
+// Qt
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QSize>
+#include <QTest>
+
+#include <vector>
+
+using namespace Breeze;
+
+/**
+ * Check that the vectorized box blur kernels are bit-exact with the scalar one,
+ * and that the tiled and parallel passes are bit-exact with a plain walk over
+ * the rows and columns.
+ *
+ * The kernel is picked at runtime, so a difference would only show up as
+ * slightly different shadows on some CPUs.
+ **/
+class BoxBlurTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testKernel_data();
+    void testKernel();
+    void testBlur_data();
+    void testBlur();
+
+private:
+    /**
+     * Blur lines with three box filters, like the renderer, using the scalar kernel.
+     **/
+    QByteArray blurScalar(const QByteArray &mask, int length, const std::array<BoxLobes, 3> &lobes) const;
+
+    /**
+     * Blur lines with three box filters, like the renderer, using a vectorized kernel.
+     **/
+    QByteArray blurLanes(BoxBlurLanesFunc blurLanes, const QByteArray &mask, int length, const std::array<BoxLobes, 3> &lobes) const;
+
+    /**
+     * Blur an image like the renderer used to, column by column with the scalar kernel.
+     **/
+    QByteArray blurColumnByColumn(const QByteArray &image, int width, int height, int pixelStride, int rowStride, int radius) const;
+};
+
+void BoxBlurTest::testKernel_data()
+{
+    QTest::addColumn<int>("kernel");
+    QTest::addColumn<int>("radius");
+
+    const struct {
+        const char *name;
+        BoxBlurKernel kernel;
+    } kernels[] = {
+        {"sse2", BoxBlurKernel::Sse2},
+        {"avx2", BoxBlurKernel::Avx2},
+    };
+
+    // The radii of the shadow presets, and a few odd ones.
+    for (const auto &kernel : kernels) {
+        for (int radius : {2, 3, 5, 8, 16, 24, 32, 48, 64, 99, 128}) {
+            QTest::addRow("%s radius %d", kernel.name, radius) << int(kernel.kernel) << radius;
+        }
+    }
+}
+
+void BoxBlurTest::testKernel()
+{
+    QFETCH(int, kernel);
+    QFETCH(int, radius);
+
+    const BoxBlurLanesFunc func = boxBlurLanesFunc(BoxBlurKernel(kernel));
+    if (!func) {
+        QSKIP("The kernel is not supported by this CPU");
+    }
+
+    const std::array<BoxLobes, 3> lobes = computeLobes(radius);
+    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
+
+    QRandomGenerator random(radius);
+    for (int iteration = 0; iteration < 16; ++iteration) {
+        // The lines are at least as long as the box filters, as in a shadow mask.
+        const int length = 2 * blurRadius + 1 + random.bounded(256);
+
+        // Noise, and sharp steps like the edges of a rasterized box.
+        QByteArray mask(BlurLaneCount * length, Qt::Uninitialized);
+        for (int i = 0; i < mask.size(); ++i) {
+            mask[i] = char(iteration % 2 ? random.bounded(256) : (random.bounded(8) ? 0 : 255));
+        }
+
+        QCOMPARE(blurLanes(func, mask, length, lobes), blurScalar(mask, length, lobes));
+    }
+}
+
+void BoxBlurTest::testBlur_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("pixelStride");
+    QTest::addColumn<int>("threadCount");
+
+    // Sizes that are not multiples of the tiles, nor of the lanes of the kernels.
+    const QSize sizes[] = {{63, 130}, {200, 65}, {64, 64}, {129, 71}};
+    for (const QSize &size : sizes) {
+        for (int pixelStride : {1, 4}) {
+            for (int threadCount : {1, 4}) {
+                QTest::addRow("%dx%d, %d bytes per pixel, %d threads", size.width(), size.height(), pixelStride, threadCount)
+                    << size.width() << size.height() << pixelStride << threadCount;
+            }
+        }
+    }
+}
+
+void BoxBlurTest::testBlur()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, pixelStride);
+    QFETCH(int, threadCount);
+
+    // Padded rows, as in a QImage.
+    const int rowStride = (width * pixelStride + 3) & ~3;
+
+    QRandomGenerator random(width * height);
+    for (int radius : {2, 5, 16, 24}) {
+        // A box, with noise around it.
+        QByteArray image(rowStride * height, Qt::Uninitialized);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < rowStride; ++x) {
+                const bool inside = x / pixelStride > width / 4 && y > height / 4;
+                image[y * rowStride + x] = char(inside ? 255 : random.bounded(8) ? 0 : random.bounded(256));
+            }
+        }
+
+        QByteArray blurred = image;
+        boxBlurAlpha(reinterpret_cast<uint8_t *>(blurred.data()), width, height, pixelStride, rowStride, radius, threadCount);
+
+        QCOMPARE(blurred, blurColumnByColumn(image, width, height, pixelStride, rowStride, radius));
+    }
+}
+
+QByteArray BoxBlurTest::blurScalar(const QByteArray &mask, int length, const std::array<BoxLobes, 3> &lobes) const
+{
+    QByteArray result(mask.size(), Qt::Uninitialized);
+    std::vector<uint8_t> buf1(length);
+    std::vector<uint8_t> buf2(length);
+
+    for (int lane = 0; lane < BlurLaneCount; ++lane) {
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(mask.constData()) + lane * length;
+        uint8_t *out = reinterpret_cast<uint8_t *>(result.data()) + lane * length;
+        boxBlurRowAlpha(in, buf1.data(), length, 1, length, lobes[0], false, false);
+        boxBlurRowAlpha(buf1.data(), buf2.data(), length, 1, length, lobes[1], false, false);
+        boxBlurRowAlpha(buf2.data(), out, length, 1, length, lobes[2], false, false);
+    }
+
+    return result;
+}
+
+QByteArray BoxBlurTest::blurLanes(BoxBlurLanesFunc blurLanes, const QByteArray &mask, int length, const std::array<BoxLobes, 3> &lobes) const
+{
+    // The kernels work on interleaved lines.
+    std::vector<uint32_t> buf1(BlurLaneCount * length);
+    std::vector<uint32_t> buf2(BlurLaneCount * length);
+    for (int lane = 0; lane < BlurLaneCount; ++lane) {
+        for (int i = 0; i < length; ++i) {
+            buf1[i * BlurLaneCount + lane] = uint8_t(mask[lane * length + i]);
+        }
+    }
+
+    blurLanes(buf1.data(), buf2.data(), length, lobes[0]);
+    blurLanes(buf2.data(), buf1.data(), length, lobes[1]);
+    blurLanes(buf1.data(), buf2.data(), length, lobes[2]);
+
+    QByteArray result(mask.size(), Qt::Uninitialized);
+    for (int lane = 0; lane < BlurLaneCount; ++lane) {
+        for (int i = 0; i < length; ++i) {
+            result[lane * length + i] = char(buf2[i * BlurLaneCount + lane]);
+        }
+    }
+
+    return result;
+}
+
+QByteArray BoxBlurTest::blurColumnByColumn(const QByteArray &image, int width, int height, int pixelStride, int rowStride, int radius) const
+{
+    const std::array<BoxLobes, 3> lobes = computeLobes(radius);
+
+    QByteArray result = image;
+    uint8_t *data = reinterpret_cast<uint8_t *>(result.data());
+    std::vector<uint8_t> buf1(qMax(width, height));
+    std::vector<uint8_t> buf2(qMax(width, height));
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t *row = data + y * rowStride;
+        boxBlurRowAlpha(row, buf1.data(), width, 1, pixelStride, lobes[0], true, false);
+        boxBlurRowAlpha(buf1.data(), buf2.data(), width, 1, pixelStride, lobes[1], false, false);
+        boxBlurRowAlpha(buf2.data(), row, width, 1, pixelStride, lobes[2], false, true);
+    }
+
+    for (int x = 0; x < width; ++x) {
+        uint8_t *column = data + x * pixelStride;
+        boxBlurRowAlpha(column, buf1.data(), height, 1, rowStride, lobes[0], true, false);
+        boxBlurRowAlpha(buf1.data(), buf2.data(), height, 1, rowStride, lobes[1], false, false);
+        boxBlurRowAlpha(buf2.data(), column, height, 1, rowStride, lobes[2], false, true);
+    }
+
+    return result;
+}
+
+QTEST_APPLESS_MAIN(BoxBlurTest)
+
+#include "boxblurtest.moc"
@@ -0,0 +1,261 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// own
+#include "breezebuttonglyphs.h"
+
+// Qt
+#include <QPaintDevice>
+#include <QPaintEngine>
+#include <QPainter>
+#include <QPolygonF>
+#include <QTest>
+
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+
+#if defined(__GLIBC__)
+#define BREEZE_COUNT_ALLOCATIONS 1
+
+/*
+ * Count the heap allocations of the whole process, Qt included, by
+ * interposing the allocation functions of glibc. Qt containers allocate with
+ * malloc rather than operator new, so overriding operator new is not enough.
+ */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+}
+
+static std::atomic<int> s_allocations = 0;
+
+extern "C" {
+void *malloc(size_t size) noexcept
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+#endif
+
+using namespace Breeze;
+
+/**
+ * A paint engine that only counts the primitives it is given.
+ *
+ * It claims every feature, so that QPainter hands the glyphs over as they
+ * are rather than converting them to paths first. What remains to allocate
+ * is then up to the glyphs alone.
+ **/
+class CountingPaintEngine : public QPaintEngine
+{
+public:
+    CountingPaintEngine()
+        : QPaintEngine(QPaintEngine::AllFeatures)
+    {
+    }
+
+    bool begin(QPaintDevice *) override
+    {
+        return true;
+    }
+
+    bool end() override
+    {
+        return true;
+    }
+
+    void updateState(const QPaintEngineState &) override
+    {
+    }
+
+    void drawPixmap(const QRectF &, const QPixmap &, const QRectF &) override
+    {
+    }
+
+    using QPaintEngine::drawPolygon;
+    void drawPolygon(const QPointF *, int, PolygonDrawMode) override
+    {
+        ++primitives;
+    }
+
+    void drawPath(const QPainterPath &) override
+    {
+        ++primitives;
+    }
+
+    Type type() const override
+    {
+        return QPaintEngine::User;
+    }
+
+    int primitives = 0;
+};
+
+/**
+ * A paint device for CountingPaintEngine.
+ **/
+class CountingPaintDevice : public QPaintDevice
+{
+public:
+    QPaintEngine *paintEngine() const override
+    {
+        return &engine;
+    }
+
+    mutable CountingPaintEngine engine;
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmWidth:
+        case PdmHeight:
+            return 40;
+        case PdmWidthMM:
+        case PdmHeightMM:
+            return 10;
+        case PdmDepth:
+            return 32;
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:
+            return 96;
+        default:
+            return QPaintDevice::metric(metric);
+        }
+    }
+};
+
+/**
+ * Check that drawing the button glyphs does not allocate.
+ *
+ * The glyphs used to be built as polygons on every render.
+ **/
+class ButtonGlyphsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testCounter();
+    void testContextHelpPath();
+    void testGlyphs();
+
+private:
+    /**
+     * The number of allocations since the process started.
+     **/
+    static int allocations();
+
+    /**
+     * Draw all glyphs, with the code of Button::renderIcon.
+     *
+     * @returns The number of glyphs.
+     **/
+    static int drawGlyphs(QPainter *painter);
+};
+
+void ButtonGlyphsTest::initTestCase()
+{
+#ifndef BREEZE_COUNT_ALLOCATIONS
+    QSKIP("Counting allocations requires glibc");
+#endif
+}
+
+int ButtonGlyphsTest::allocations()
+{
+#ifdef BREEZE_COUNT_ALLOCATIONS
+    return s_allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+void ButtonGlyphsTest::testCounter()
+{
+    // Make sure that the allocations of Qt are seen at all.
+    const int before = allocations();
+    const QPolygonF polygon(std::begin(ButtonGlyphs::ChevronDown), std::end(ButtonGlyphs::ChevronDown));
+    QCOMPARE(polygon.size(), 3);
+    QVERIFY(allocations() > before);
+}
+
+void ButtonGlyphsTest::testContextHelpPath()
+{
+    // The path is built by the first call only, and later copies share it.
+    QVERIFY(!ButtonGlyphs::contextHelpPath().isEmpty());
+
+    const int before = allocations();
+    for (int i = 0; i < 16; ++i) {
+        const QPainterPath path = ButtonGlyphs::contextHelpPath();
+        QVERIFY(!path.isEmpty());
+    }
+    QCOMPARE(allocations(), before);
+}
+
+void ButtonGlyphsTest::testGlyphs()
+{
+    CountingPaintDevice device;
+
+    QPainter painter(&device);
+    painter.setRenderHints(QPainter::Antialiasing);
+    painter.scale(2, 2);
+    painter.setPen(QPen(Qt::black, 1.2, Qt::SolidLine, Qt::RoundCap, Qt::MiterJoin));
+
+    // The painter sets up its state the first time it draws, and the context
+    // help path is built by the first call.
+    drawGlyphs(&painter);
+    device.engine.primitives = 0;
+
+    const int before = allocations();
+    const int glyphs = drawGlyphs(&painter);
+    QCOMPARE(allocations() - before, 0);
+
+    // Every glyph reached the paint engine, as a single primitive.
+    QCOMPARE(device.engine.primitives, glyphs);
+}
+
+int ButtonGlyphsTest::drawGlyphs(QPainter *painter)
+{
+    // ContextHelp is the last glyph.
+    const int count = int(ButtonGlyphs::Glyph::ContextHelp) + 1;
+    for (int glyph = 0; glyph < count; ++glyph) {
+        ButtonGlyphs::drawGlyph(painter, ButtonGlyphs::Glyph(glyph));
+    }
+    return count;
+}
+
+QTEST_GUILESS_MAIN(ButtonGlyphsTest)
+
+#include "buttonglyphstest.moc"
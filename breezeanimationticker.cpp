@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "breezeanimationticker.h"
+
+#include "breezebutton.h"
+
+#include <QHash>
+#include <QRegion>
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    AnimationTicker &AnimationTicker::self()
+    {
+        static AnimationTicker ticker;
+        return ticker;
+    }
+
+    //__________________________________________________________________
+    AnimationTicker::AnimationTicker()
+    {
+        m_timer.setTimerType(Qt::PreciseTimer);
+        m_timer.setInterval(s_frameInterval);
+        connect(&m_timer, &QTimer::timeout, this, &AnimationTicker::tick);
+    }
+
+    //__________________________________________________________________
+    void AnimationTicker::start(Button *button)
+    {
+        if (m_buttons.contains(button))
+            return;
+
+        m_buttons.append(button);
+        if (!m_timer.isActive())
+        {
+            m_clock.start();
+            m_timer.start();
+        }
+    }
+
+    //__________________________________________________________________
+    void AnimationTicker::stop(Button *button)
+    {
+        m_buttons.removeOne(button);
+        if (m_buttons.isEmpty())
+            m_timer.stop();
+    }
+
+    //__________________________________________________________________
+    void AnimationTicker::tick()
+    {
+        const qint64 elapsed = m_clock.restart();
+
+        // the damaged area of each decoration, repainted at once
+        QHash<KDecoration3::Decoration *, QRegion> damage;
+
+        for (auto it = m_buttons.begin(); it != m_buttons.end();)
+        {
+            Button *button = *it;
+
+            const qreal opacity = button->opacity();
+            const bool running = button->advanceAnimation(elapsed);
+
+            // the colors of the last frame differ from those of the animation
+            if (!running) damage[button->decoration()] += button->geometry().toAlignedRect();
+            else if (button->opacity() != opacity) damage[button->decoration()] += button->animationDamage(opacity).toAlignedRect();
+
+            if (running) ++it;
+            else it = m_buttons.erase(it);
+        }
+
+        // buttons on either side of the title bar are damaged separately, not through their bounding rect
+        for (auto it = damage.constBegin(); it != damage.constEnd(); ++it)
+        {
+            for (const QRect &rect : it.value())
+                it.key()->update(rect);
+        }
+
+        if (m_buttons.isEmpty())
+            m_timer.stop();
+    }
+
+}
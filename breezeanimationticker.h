@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+namespace Breeze
+{
+
+    class Button;
+
+    //* process-wide driver of the button hover animations
+    /**
+    A single timer advances the animations of all buttons together. It only runs
+    while some button is animating, and the parts of the buttons that changed
+    are repainted together, once per frame.
+    */
+    class AnimationTicker : public QObject
+    {
+
+        Q_OBJECT
+
+        public:
+
+        //* singleton
+        static AnimationTicker &self();
+
+        //* advance the animation of given button until it is done
+        void start(Button *button);
+
+        //* stop advancing the animation of given button
+        void stop(Button *button);
+
+        private:
+
+        //* constructor
+        AnimationTicker();
+
+        //* advance all animations by the time elapsed since the last frame
+        void tick();
+
+        //* buttons being animated
+        QList<Button *> m_buttons;
+
+        //* fires once per frame while some button is animating
+        QTimer m_timer;
+
+        //* time since the last frame
+        QElapsedTimer m_clock;
+
+        //* interval between frames, in milliseconds
+        static constexpr int s_frameInterval = 16;
+
+    };
+
+}
@@ -20,45 +20,49 @@
  */
 #include "breezebutton.h"
 
-#include <KColorUtils>
+#include "breezeanimationticker.h"
+#include "breezebuttonglyphs.h"
+
 #include <KDecoration3/DecoratedWindow>
 //#include <KIconLoader>
 
+#include <QIcon>
 #include <QPainter>
 #include <QPainterPath>
-#include <QVariantAnimation>
+#include <QEasingCurve>
+
+#include <cmath>
 
 namespace Breeze
 {
     using KDecoration3::ColorGroup;
     using KDecoration3::ColorRole;
     using KDecoration3::DecorationButtonType;
+    using namespace ButtonGlyphs;
 
 
     //__________________________________________________________________
     Button::Button(DecorationButtonType type, Decoration* decoration, QObject* parent)
         : DecorationButton(type, decoration, parent)
-        , m_animation(new QVariantAnimation(this))
     {
 
-        // setup animation
-        // It is important start and end value are of the same type, hence 0.0 and not just 0
-        m_animation->setStartValue(0.0);
-        m_animation->setEndValue(1.0);
-        m_animation->setEasingCurve(QEasingCurve::InOutQuad);
-        connect(m_animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
-            setOpacity(value.toReal());
-        });
-
         // connections
         connect(decoration->window(), SIGNAL(iconChanged(QIcon)), this, SLOT(update()));
         connect(decoration->settings().get(), &KDecoration3::DecorationSettings::reconfigured, this, &Button::reconfigure);
         connect(this, &KDecoration3::DecorationButton::hoveredChanged, this, &Button::updateAnimationState);
+        connect(this, &KDecoration3::DecorationButton::visibilityChanged, this, &Button::updateAnimationVisibility);
+        connect(decoration->window(), &KDecoration3::DecoratedWindow::shadedChanged, this, &Button::updateAnimationVisibility);
 
         reconfigure();
 
     }
 
+    //__________________________________________________________________
+    Button::~Button()
+    {
+        AnimationTicker::self().stop(this);
+    }
+
     //__________________________________________________________________
     Button::Button(QObject *parent, const QVariantList &args)
         : Button(args.at(0).value<DecorationButtonType>(), args.at(1).value<Decoration*>(), parent)
@@ -102,7 +106,10 @@ namespace Breeze
                 break;
 
                 case DecorationButtonType::Menu:
-                QObject::connect(c, &KDecoration3::DecoratedWindow::iconChanged, b, [b]() { b->update(); });
+                QObject::connect(c, &KDecoration3::DecoratedWindow::iconChanged, b, [b]() {
+                    b->m_menuIcon = QPixmap();
+                    b->update();
+                });
                 break;
 
                 default: break;
@@ -142,7 +149,7 @@ namespace Breeze
                     KIconLoader::global()->setCustomPalette(palette);
                 }
             } else {*/
-                w->icon().paint(painter, iconRect.toRect());
+                drawMenuIcon(painter, iconRect.toRect());
             //}
         }
         else
@@ -152,8 +159,118 @@ namespace Breeze
 
     }
 
+    //__________________________________________________________________
+    void Button::drawMenuIcon(QPainter *painter, const QRect &rect) const
+    {
+
+        const qreal devicePixelRatio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+        const QIcon icon = decoration()->window()->icon();
+
+        // rendering the window icon may involve scaling or rasterizing an svg
+        if (m_menuIcon.isNull()
+            || m_menuIconCacheKey != icon.cacheKey()
+            || m_menuIconSize != rect.size()
+            || m_menuIconDevicePixelRatio != devicePixelRatio)
+        {
+            // compare against the requested ratio: the pixmap may come with another one
+            m_menuIcon = icon.pixmap(rect.size(), devicePixelRatio);
+            m_menuIconCacheKey = icon.cacheKey();
+            m_menuIconSize = rect.size();
+            m_menuIconDevicePixelRatio = devicePixelRatio;
+        }
+
+        if (m_menuIcon.isNull()) return;
+
+        // centered, like QIcon::paint
+        QRectF target(QPointF(0, 0), m_menuIcon.deviceIndependentSize());
+        target.moveCenter(QRectF(rect).center());
+        painter->drawPixmap(target, m_menuIcon, QRectF(m_menuIcon.rect()));
+
+    }
+
     //__________________________________________________________________
     void Button::drawIcon(QPainter *painter) const
+    {
+
+        const QRectF rect = geometry().marginsRemoved(m_padding);
+
+        const qreal devicePixelRatio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+
+        /*
+        with fractional scaling the icon may start between two device pixels.
+        The image is drawn at the device pixel before it and the remainder is
+        rendered into the image, so that it looks exactly like direct rendering.
+        The painter is only translated, so mapping the position is enough.
+        The remainder is rounded to 1/64 pixel, the precision of the rasterizer,
+        so that floating point noise does not add cache entries.
+        */
+        const QPointF devicePosition = painter->transform().map(rect.topLeft()) * devicePixelRatio;
+        const auto subpixel = [](qreal value) { return std::fmod(std::round((value - std::floor(value)) * 64), 64) / 64; };
+        const QPointF phase(subpixel(devicePosition.x()), subpixel(devicePosition.y()));
+
+        const ButtonIconKey key = iconKey(rect.size(), devicePixelRatio, phase);
+
+        // identical icons of all windows are rendered once
+        QImage image = ButtonIconCache::self().icon(key);
+        if (image.isNull())
+        {
+            image = QImage(key.pixelSize, QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(devicePixelRatio);
+            image.fill(Qt::transparent);
+
+            QPainter iconPainter(&image);
+            iconPainter.translate(phase / devicePixelRatio);
+            renderIcon(&iconPainter, rect.width());
+            iconPainter.end();
+
+            ButtonIconCache::self().insert(key, image);
+        }
+
+        painter->drawImage(rect.topLeft() - phase / devicePixelRatio, image);
+
+    }
+
+    //__________________________________________________________________
+    QColor Button::inactiveColor() const
+    {
+        if (isInactive())
+            return qobject_cast<Decoration*>(decoration())->buttonPalette().inactive;
+        return QColor(Qt::gray);
+    }
+
+    //__________________________________________________________________
+    bool Button::isInactive() const
+    {
+        auto d = qobject_cast<Decoration*>(decoration());
+        return d && !d->buttonPalette().active
+               && !isHovered() && !isPressed()
+               && !m_animating;
+    }
+
+    //__________________________________________________________________
+    ButtonIconKey Button::iconKey(const QSizeF &size, qreal devicePixelRatio, const QPointF &phase) const
+    {
+        auto d = qobject_cast<Decoration*>(decoration());
+
+        ButtonIconKey key;
+        key.type = int(type());
+        key.checked = isChecked();
+        key.pressed = isPressed();
+        key.hovered = isHovered();
+        key.inactive = isInactive();
+        key.macOS = !d || d->internalSettings()->macOSButtons();
+        key.animationValue = m_opacity;
+        key.pixelSize = QSize(std::ceil(size.width() * devicePixelRatio + phase.x()), std::ceil(size.height() * devicePixelRatio + phase.y()));
+        key.devicePixelRatio = devicePixelRatio;
+        key.phase = phase;
+        key.titleBarColor = d ? d->buttonPalette().titleBar.rgba() : 0;
+        key.foregroundColor = foregroundColor().rgba();
+        key.backgroundColor = backgroundColor().rgba();
+        return key;
+    }
+
+    //__________________________________________________________________
+    void Button::renderIcon(QPainter *painter, qreal width) const
     {
 
         painter->setRenderHints(QPainter::Antialiasing);
@@ -163,10 +280,6 @@ namespace Breeze
         this makes all further rendering and scaling simpler
         all further rendering is performed inside QRect(0, 0, 18, 18)
         */
-        const QRectF rect = geometry().marginsRemoved(m_padding);
-        painter->translate(rect.topLeft());
-
-        const qreal width(rect.width());
         painter->scale(width/20, width/20);
         painter->translate(1, 1);
 
@@ -174,23 +287,11 @@ namespace Breeze
         const QColor backgroundColor(this->backgroundColor());
 
         auto d = qobject_cast<Decoration*>(decoration());
-        bool isInactive(d && !d->window()->isActive()
-                        && !isHovered() && !isPressed()
-                        && m_animation->state() != QAbstractAnimation::Running);
-        QColor inactiveCol(Qt::gray);
-        if (isInactive)
-        {
-            int gray = qGray(d->titleBarColor().rgb());
-            if (gray <= 200) {
-                gray += 55;
-                gray = qMax(gray, 115);
-            }
-            else gray -= 45;
-            inactiveCol = QColor(gray, gray, gray);
-        }
+        const bool isInactive(this->isInactive());
+        const QColor inactiveCol(inactiveColor());
 
         // render mark
-        const QColor foregroundColor(this->foregroundColor(inactiveCol));
+        const QColor foregroundColor(this->foregroundColor());
         if (foregroundColor.isValid())
         {
 
@@ -207,7 +308,7 @@ namespace Breeze
                 {
                     if (!d || d->internalSettings()->macOSButtons()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         {
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(255, 92, 87));
@@ -230,7 +331,7 @@ namespace Breeze
                             painter->setBrush(backgroundColor);
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse(c, r, r);
                         }
@@ -255,7 +356,7 @@ namespace Breeze
                 {
                     if (!d || d->internalSettings()->macOSButtons()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         {
                             grad.setColorAt(0, isChecked() ? isInactive ? inactiveCol
                                                                         : QColor(67, 198, 176)
@@ -286,7 +387,7 @@ namespace Breeze
                             painter->setBrush(backgroundColor);
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse(c, r, r);
                         }
@@ -304,13 +405,11 @@ namespace Breeze
                         painter->setPen(pen);
                         painter->setBrush(Qt::NoBrush);
 
-                        painter->drawPolyline(QPolygonF()
-                                                << QPointF(5, 8) << QPointF(5, 13) << QPointF(10, 13));
+                        drawGlyph(painter, Glyph::MaximizeLowerCorner);
                         if (isChecked())
                             painter->drawRect(QRectF(8.0, 5.0, 5.0, 5.0));
                         else {
-                            painter->drawPolyline(QPolygonF()
-                                                  << QPointF(8, 5) << QPointF(13, 5) << QPointF(13, 10));
+                            drawGlyph(painter, Glyph::MaximizeUpperCorner);
                         }
 
                         if (isHovered())
@@ -323,7 +422,7 @@ namespace Breeze
                 {
                     if (!d || d->internalSettings()->macOSButtons()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(243, 176, 43));
@@ -346,7 +445,7 @@ namespace Breeze
                             painter->setBrush(backgroundColor);
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse(c, r, r);
                         }
@@ -377,7 +476,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(103, 149, 210));
@@ -402,7 +501,7 @@ namespace Breeze
                                 painter->setPen(Qt::NoPen);
                                 painter->setBrush(backgroundColor);
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse(c, r, r);
                             }
@@ -427,7 +526,7 @@ namespace Breeze
 
                                 // center dot
                                 QColor backgroundColor(this->backgroundColor());
-                                if (!backgroundColor.isValid() && d) backgroundColor = d->titleBarColor();
+                                if (!backgroundColor.isValid() && d) backgroundColor = d->buttonPalette().titleBar;
 
                                 if (backgroundColor.isValid())
                                 {
@@ -437,11 +536,7 @@ namespace Breeze
 
                             }
                             else {
-                                painter->drawPolygon(QPolygonF()
-                                    << QPointF(6.5, 8.5)
-                                    << QPointF(12, 3)
-                                    << QPointF(15, 6)
-                                    << QPointF(9.5, 11.5));
+                                drawGlyph(painter, Glyph::PinHead);
 
                                 painter->setPen(pen);
                                 painter->drawLine(QPointF(5.5, 7.5), QPointF(10.5, 12.5));
@@ -457,7 +552,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(103, 149, 210));
@@ -482,7 +577,7 @@ namespace Breeze
                                 painter->setPen(Qt::NoPen);
                                 painter->setBrush(backgroundColor);
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse(c, r, r);
                             }
@@ -500,17 +595,11 @@ namespace Breeze
 
                         painter->drawLine(5, 6, 13, 6);
                         if (isChecked()) {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 9)
-                                << QPointF(9, 13)
-                                << QPointF(13, 9));
+                            drawGlyph(painter, Glyph::ChevronDown);
 
                         }
                         else {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 13)
-                                << QPointF(9, 9)
-                                << QPointF(13, 13));
+                            drawGlyph(painter, Glyph::ChevronUp);
                         }
                     }
 
@@ -523,7 +612,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons() || isChecked());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(103, 149, 210));
@@ -548,7 +637,7 @@ namespace Breeze
                                 painter->setPen(Qt::NoPen);
                                 painter->setBrush(backgroundColor);
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse(c, r, r);
                             }
@@ -565,26 +654,14 @@ namespace Breeze
                         painter->setBrush(Qt::NoBrush);
 
                         if (macOSBtn) {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(6, 6)
-                                << QPointF(9, 9)
-                                << QPointF(12, 6));
-
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(6, 10)
-                                << QPointF(9, 13)
-                                << QPointF(12, 10));
+                            drawGlyph(painter, Glyph::SmallChevronDownHigh);
+
+                            drawGlyph(painter, Glyph::SmallChevronDown);
                         }
                         else {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 5)
-                                << QPointF(9, 9)
-                                << QPointF(13, 5));
-
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 9)
-                                << QPointF(9, 13)
-                                << QPointF(13, 9));
+                            drawGlyph(painter, Glyph::ChevronDownHigh);
+
+                            drawGlyph(painter, Glyph::ChevronDown);
                         }
                     }
                     break;
@@ -596,7 +673,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(103, 149, 210));
@@ -621,7 +698,7 @@ namespace Breeze
                                 painter->setPen(Qt::NoPen);
                                 painter->setBrush(backgroundColor);
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse(c, r, r);
                             }
@@ -638,26 +715,14 @@ namespace Breeze
                         painter->setBrush(Qt::NoBrush);
 
                         if (macOSBtn) {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(6, 8)
-                                << QPointF(9, 5)
-                                << QPointF(12, 8));
-
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(6, 12)
-                                << QPointF(9, 9)
-                                << QPointF(12, 12));
+                            drawGlyph(painter, Glyph::SmallChevronUpHigh);
+
+                            drawGlyph(painter, Glyph::SmallChevronUp);
                         }
                         else {
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 9)
-                                << QPointF(9, 5)
-                                << QPointF(13, 9));
-
-                            painter->drawPolyline(QPolygonF()
-                                << QPointF(5, 13)
-                                << QPointF(9, 9)
-                                << QPointF(13, 13));
+                            drawGlyph(painter, Glyph::ChevronUpHigh);
+
+                            drawGlyph(painter, Glyph::ChevronUp);
                         }
                     }
                     break;
@@ -669,7 +734,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(230, 129, 67));
@@ -691,7 +756,7 @@ namespace Breeze
                             painter->setPen(Qt::NoPen);
                             painter->setBrush(backgroundColor);
                             qreal r = static_cast<qreal>(7)
-                                      + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                      + static_cast<qreal>(2) * m_opacity;
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse(c, r, r);
                         }
@@ -725,7 +790,7 @@ namespace Breeze
                     bool macOSBtn(!d || d->internalSettings()->macOSButtons());
                     if (macOSBtn && !isPressed()) {
                         QLinearGradient grad(QPointF(9, 2), QPointF(9, 16));
-                        if (d && qGray(d->titleBarColor().rgb()) > 100)
+                        if (d && d->buttonPalette().light)
                         { // yellow isn't good with light backgrounds
                             grad.setColorAt(0, isInactive ? inactiveCol
                                                           : QColor(103, 149, 210));
@@ -747,7 +812,7 @@ namespace Breeze
                             painter->setPen(Qt::NoPen);
                             painter->setBrush(backgroundColor);
                             qreal r = static_cast<qreal>(7)
-                                      + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                      + static_cast<qreal>(2) * m_opacity;
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse(c, r, r);
                         }
@@ -762,11 +827,7 @@ namespace Breeze
                         painter->setPen(pen);
                         painter->setBrush(Qt::NoBrush);
 
-                        QPainterPath path;
-                        path.moveTo(5, 6);
-                        path.arcTo(QRectF(5, 3.5, 8, 5), 180, -180);
-                        path.cubicTo(QPointF(12.5, 9.5), QPointF(9, 7.5), QPointF(9, 11.5));
-                        painter->drawPath(path);
+                        drawGlyph(painter, Glyph::ContextHelp);
 
                         painter->drawPoint(9, 15);
                     }
@@ -783,56 +844,43 @@ namespace Breeze
     }
 
     //__________________________________________________________________
-    QColor Button::foregroundColor(const QColor& inactiveCol) const
+    QColor Button::foregroundColor() const
     {
         auto d = qobject_cast<Decoration*>(decoration());
-        if (!d || d->internalSettings()->macOSButtons()) {
-            QColor col;
-            if (d && !d->window()->isActive()
-                && !isHovered() && !isPressed()
-                && m_animation->state() != QAbstractAnimation::Running)
-            {
-                int v = qGray(inactiveCol.rgb());
-                if (v > 127) v -= 127;
-                else v += 128;
-                col = QColor(v, v, v);
-            }
-            else
-            {
-                if (d && qGray(d->titleBarColor().rgb()) > 100)
-                    col = QColor(250, 250, 250);
-                else
-                    col = QColor(40, 40, 40);
-            }
-            return col;
+        if (!d) {
+
+            return QColor(40, 40, 40);
+
         }
-        else if (!d) {
 
-            return QColor();
+        const ButtonPalette &palette = d->buttonPalette();
+        if (d->internalSettings()->macOSButtons()) {
+
+            return isInactive() ? palette.inactiveSymbol : palette.symbol;
 
         } else if (isPressed()) {
 
-            return d->titleBarColor();
+            return palette.titleBar;
 
         /*} else if (type() == DecorationButtonType::Close && d->internalSettings()->outlineCloseButton()) {
 
-            return d->titleBarColor();*/
+            return palette.titleBar;*/
 
         } else if ((type() == DecorationButtonType::KeepBelow || type() == DecorationButtonType::KeepAbove) && isChecked()) {
 
-            return d->titleBarColor();
+            return palette.titleBar;
 
-        } else if (m_animation->state() == QAbstractAnimation::Running) {
+        } else if (m_animating) {
 
-            return KColorUtils::mix(d->fontColor(), d->titleBarColor(), m_opacity);
+            return palette.fontToTitleBar[qRound(m_opacity * ButtonPalette::AnimationFrames)];
 
         } else if (isHovered()) {
 
-            return d->titleBarColor();
+            return palette.titleBar;
 
         } else {
 
-            return d->fontColor();
+            return palette.font;
 
         }
 
@@ -848,219 +896,133 @@ namespace Breeze
 
         }
 
+        const ButtonPalette &palette = d->buttonPalette();
         if (d->internalSettings()->macOSButtons()) {
+
+            if (isPressed()) return palette.pressed[paletteKind()];
+            else if (m_animating || isHovered()) return palette.hovered[paletteKind()];
+            else return QColor();
+
+        } else {
+
+            const bool isClose = type() == DecorationButtonType::Close;
             if (isPressed()) {
 
-                QColor col;
-                if (type() == DecorationButtonType::Close)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(254, 73, 66);
-                    else
-                        col = QColor(240, 77, 80);
-                }
-                else if (type() == DecorationButtonType::Maximize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = isChecked() ? QColor(0, 188, 154) : QColor(7, 201, 33);
-                    else
-                        col = isChecked() ? QColor(0, 188, 154) : QColor(101, 188, 34);
-                }
-                else if (type() == DecorationButtonType::Minimize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(233, 160, 13);
-                    else
-                        col = QColor(227, 185, 59);
-                }
-                else if (type() == DecorationButtonType::ApplicationMenu) {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(220, 124, 64);
-                    else
-                        col = QColor(240, 139, 96);
-                }
-                else {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(83, 121, 170);
-                    else
-                        col = QColor(110, 136, 180);
-                }
-                if (col.isValid())
-                    return col;
-                else return KColorUtils::mix(d->titleBarColor(), d->fontColor(), 0.3);
+                return isClose ? palette.warning : palette.pressedFill;
 
-            } else if (m_animation->state() == QAbstractAnimation::Running) {
+            } else if ((type() == DecorationButtonType::KeepBelow || type() == DecorationButtonType::KeepAbove) && isChecked()) {
 
-                QColor col;
-                if (type() == DecorationButtonType::Close)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(254, 95, 87);
-                    else
-                        col = QColor(240, 96, 97);
-                }
-                else if (type() == DecorationButtonType::Maximize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = isChecked() ? QColor(64, 188, 168) : QColor(39, 201, 63);
-                    else
-                        col = isChecked() ? QColor(64, 188, 168) : QColor(116, 188, 64);
-                }
-                else if (type() == DecorationButtonType::Minimize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(233, 172, 41);
-                    else
-                        col = QColor(227, 191, 78);
-                }
-                else if (type() == DecorationButtonType::ApplicationMenu) {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(220, 124, 64);
-                    else
-                        col = QColor(240, 139, 96);
-                }
-                else {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(98, 141, 200);
-                    else
-                        col = QColor(128, 157, 210);
-                }
-                if (col.isValid())
-                    return col;
-                else {
+                return palette.hoveredFill;
 
-                    col = d->fontColor();
-                    col.setAlpha(col.alpha()*m_opacity);
-                    return col;
+            } else if (m_animating) {
 
-                }
+                QColor color(isClose ? palette.warningHovered : palette.hoveredFill);
+                color.setAlpha(color.alpha()*m_opacity);
+                return color;
 
             } else if (isHovered()) {
 
-                QColor col;
-                if (type() == DecorationButtonType::Close)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(254, 95, 87);
-                    else
-                        col = QColor(240, 96, 97);
-                }
-                else if (type() == DecorationButtonType::Maximize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = isChecked() ? QColor(64, 188, 168) : QColor(39, 201, 63);
-                    else
-                        col = isChecked() ? QColor(64, 188, 168) : QColor(116, 188, 64);
-                }
-                else if (type() == DecorationButtonType::Minimize)
-                {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(233, 172, 41);
-                    else
-                        col = QColor(227, 191, 78);
-                }
-                else if (type() == DecorationButtonType::ApplicationMenu) {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(220, 124, 64);
-                    else
-                        col = QColor(240, 139, 96);
-                }
-                else {
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(98, 141, 200);
-                    else
-                        col = QColor(128, 157, 210);
-                }
-                if (col.isValid())
-                    return col;
-                else return d->fontColor();
+                return isClose ? palette.warningHovered : palette.hoveredFill;
 
             } else {
 
                 return QColor();
 
             }
+
         }
-        else {
-            auto c = d->window();
-            if (isPressed()) {
 
-                if (type() == DecorationButtonType::Close) return c->color(ColorGroup::Warning, ColorRole::Foreground);
-                else
-                {
-                    QColor col;
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(0, 0, 0, 190);
-                    else
-                        col = QColor(255, 255, 255, 210);
-                    return col;
-                }
+    }
 
-            } else if ((type() == DecorationButtonType::KeepBelow || type() == DecorationButtonType::KeepAbove) && isChecked()) {
+    //__________________________________________________________________
+    ButtonPalette::Kind Button::paletteKind() const
+    {
+        switch (type())
+        {
+            case DecorationButtonType::Close: return ButtonPalette::Close;
+            case DecorationButtonType::Maximize: return isChecked() ? ButtonPalette::MaximizeChecked : ButtonPalette::Maximize;
+            case DecorationButtonType::Minimize: return ButtonPalette::Minimize;
+            case DecorationButtonType::ApplicationMenu: return ButtonPalette::ApplicationMenu;
+            default: return ButtonPalette::Other;
+        }
+    }
 
-                    QColor col;
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(0, 0, 0, 165);
-                    else
-                        col = QColor(255, 255, 255, 180);
-                    return col;
+    //________________________________________________________________
+    void Button::reconfigure()
+    {
 
-            } else if (m_animation->state() == QAbstractAnimation::Running) {
+        // animation
+        if (auto d = qobject_cast<Decoration*>(decoration()))
+        {
+            m_animationDuration = d->internalSettings()->animationsDuration();
+            setPreferredSize(QSizeF(d->buttonSize(), d->buttonSize()));
+        }
 
-                if (type() == DecorationButtonType::Close)
-                {
+        // the title bar may have been hidden
+        updateAnimationVisibility();
 
-                    QColor color(c->color(ColorGroup::Warning, ColorRole::Foreground).lighter());
-                    color.setAlpha(color.alpha()*m_opacity);
-                    return color;
+    }
 
-                } else {
+    //__________________________________________________________________
+    bool Button::advanceAnimation(qint64 elapsed)
+    {
 
-                    QColor col;
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(0, 0, 0, 165);
-                    else
-                        col = QColor(255, 255, 255, 180);
-                    col.setAlpha(col.alpha()*m_opacity);
-                    return col;
+        const qreal step = m_animationDuration > 0 ? qreal(elapsed) / m_animationDuration : 1.0;
+        m_animationProgress = qBound<qreal>(0.0, m_animationProgress + (m_animationForward ? step : -step), 1.0);
+        m_animating = m_animationForward ? m_animationProgress < 1.0 : m_animationProgress > 0.0;
 
-                }
+        // the value is quantized, so that the frames of all animations come from the icon cache
+        static const QEasingCurve curve(QEasingCurve::InOutQuad);
+        m_opacity = std::round(curve.valueForProgress(m_animationProgress) * s_animationFrames) / s_animationFrames;
 
-            } else if (isHovered()) {
+        return m_animating;
 
-                if (type() == DecorationButtonType::Close) return c->color(ColorGroup::Warning, ColorRole::Foreground).lighter();
-                else
-                {
+    }
 
-                    QColor col;
-                    if (qGray(d->titleBarColor().rgb()) > 100)
-                        col = QColor(0, 0, 0, 165);
-                    else
-                        col = QColor(255, 255, 255, 180);
-                    return col;
+    //__________________________________________________________________
+    QRectF Button::animationDamage(qreal previousOpacity) const
+    {
 
-                }
+        /*
+        in icon coordinates, the animation changes the disc of radius 9 around (9, 9):
+        macOS-style buttons only grow or shrink the inner ring, up to that radius
+        */
+        qreal radius = 9;
+        auto d = qobject_cast<Decoration*>(decoration());
+        if (!d || d->internalSettings()->macOSButtons())
+            radius = 7 + 2 * qMax(previousOpacity, m_opacity);
 
-            } else {
+        const QRectF rect = geometry().marginsRemoved(m_padding);
+        const qreal scale = rect.width() / 20;
+        const QRectF ring(QPointF(10 - radius, 10 - radius) * scale, QSizeF(2 * radius, 2 * radius) * scale);
 
-                return QColor();
+        // one more pixel for antialiasing
+        return ring.translated(rect.topLeft()).adjusted(-1, -1, 1, 1);
 
-            }
-        }
+    }
 
+    //__________________________________________________________________
+    bool Button::isAnimationVisible() const
+    {
+        auto d = qobject_cast<Decoration*>(decoration());
+        return d && isVisible() && !d->hideTitleBar();
     }
 
-    //________________________________________________________________
-    void Button::reconfigure()
+    //__________________________________________________________________
+    void Button::finishAnimation()
     {
+        AnimationTicker::self().stop(this);
 
-        // animation
-        if (auto d = qobject_cast<Decoration*>(decoration()))
-        {
-            m_animation->setDuration(d->internalSettings()->animationsDuration());
-            setPreferredSize(QSizeF(d->buttonSize(), d->buttonSize()));
-        }
+        m_animating = false;
+        m_animationProgress = m_animationForward ? 1.0 : 0.0;
+        m_opacity = m_animationProgress;
+    }
 
+    //__________________________________________________________________
+    void Button::updateAnimationVisibility()
+    {
+        if (m_animating && !isAnimationVisible())
+            finishAnimation();
     }
 
     //__________________________________________________________________
@@ -1070,11 +1032,13 @@ namespace Breeze
         auto d = qobject_cast<Decoration*>(decoration());
         if (!(d && d->internalSettings()->animationsEnabled())) return;
 
-        QAbstractAnimation::Direction dir = hovered ? QAbstractAnimation::Forward : QAbstractAnimation::Backward;
-        if (m_animation->state() == QAbstractAnimation::Running && m_animation->direction() != dir)
-            m_animation->stop();
-        m_animation->setDirection(dir);
-        if (m_animation->state() != QAbstractAnimation::Running) m_animation->start();
+        // a reversed animation continues from where it is
+        m_animationForward = hovered;
+        m_animating = true;
+
+        // nobody would see the frames
+        if (isAnimationVisible()) AnimationTicker::self().start(this);
+        else finishAnimation();
 
     }
 
@@ -21,13 +21,11 @@
 
 #pragma once
 
+#include "breezebuttoniconcache.h"
 #include "breezedecoration.h"
 #include <KDecoration3/DecorationButton>
 
-#include <QHash>
-#include <QImage>
-
-class QVariantAnimation;
+#include <QPixmap>
 
 namespace Breeze
 {
@@ -42,7 +40,7 @@ namespace Breeze
         explicit Button(QObject *parent, const QVariantList &args);
 
         //* destructor
-        virtual ~Button() = default;
+        ~Button() override;
 
         //* button creation
         static Button *create(KDecoration3::DecorationButtonType type, KDecoration3::Decoration *decoration, QObject *parent);
@@ -70,18 +68,24 @@ namespace Breeze
 
         //*@name active state change animation
         //@{
-        void setOpacity(qreal value)
+        qreal opacity() const
         {
-            if (m_opacity == value) return;
-            m_opacity = value;
-            update();
+            return m_opacity;
         }
 
-        qreal opacity() const
+        //* whether the hover animation is running
+        bool isAnimating() const
         {
-            return m_opacity;
+            return m_animating;
         }
 
+        //* advance the hover animation by given time, in milliseconds, without repainting
+        /** returns false once the animation is done */
+        bool advanceAnimation(qint64 elapsed);
+
+        //* area that changed since the animation frame with given opacity
+        QRectF animationDamage(qreal previousOpacity) const;
+
         //@}
 
         void setPreferredSize(const QSizeF &size)
@@ -102,22 +106,46 @@ namespace Breeze
         //* animation state
         void updateAnimationState(bool);
 
+        //* finish the animation at once when it can no longer be seen
+        void updateAnimationVisibility();
+
         private:
 
         //* private constructor
         explicit Button(KDecoration3::DecorationButtonType type, Decoration *decoration, QObject *parent = nullptr);
 
-        //* draw button icon
+        //* draw the window icon of the menu button, in given rect
+        void drawMenuIcon(QPainter *, const QRect &) const;
+
+        //* draw button icon, from the icon cache
         void drawIcon(QPainter *) const;
 
+        //* render button icon, for given icon width
+        void renderIcon(QPainter *, qreal width) const;
+
+        //* color used for inactive buttons
+        QColor inactiveColor() const;
+
+        //* whether the button is drawn as inactive
+        bool isInactive() const;
+
+        //* whether the hover animation can be seen
+        bool isAnimationVisible() const;
+
+        //* jump to the end of the hover animation, without repainting
+        void finishAnimation();
+
+        //* cache key of the icon in its current state
+        ButtonIconKey iconKey(const QSizeF &size, qreal devicePixelRatio, const QPointF &phase) const;
+
         //*@name colors
         //@{
-        QColor foregroundColor(const QColor& inactiveCol) const;
+        QColor foregroundColor() const;
         QColor backgroundColor() const;
-        //@}
 
-        //* active state change animation
-        QVariantAnimation *m_animation;
+        //* which of the macOS-style colors of the palette the button uses
+        ButtonPalette::Kind paletteKind() const;
+        //@}
 
         //* padding (for rendering)
         QMargins m_padding;
@@ -127,6 +155,32 @@ namespace Breeze
 
         //* active state change opacity
         qreal m_opacity = 0;
+
+        //*@name window icon of the menu button, as last rendered
+        /** a custom icon palette, as in the disabled code of paint, would have to be checked too */
+        //@{
+        mutable QPixmap m_menuIcon;
+        mutable qint64 m_menuIconCacheKey = 0;
+        mutable QSize m_menuIconSize;
+        mutable qreal m_menuIconDevicePixelRatio = 0;
+        //@}
+
+        //*@name hover animation, driven by AnimationTicker
+        //@{
+
+        //* linear progress, from 0 to 1
+        qreal m_animationProgress = 0;
+
+        //* duration of the whole animation, in milliseconds
+        int m_animationDuration = 0;
+
+        bool m_animationForward = true;
+        bool m_animating = false;
+
+        //@}
+
+        //* number of distinct frames of the hover animation
+        static constexpr int s_animationFrames = ButtonPalette::AnimationFrames;
     };
 
 } // namespace
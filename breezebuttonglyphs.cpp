@@ -0,0 +1,96 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezebuttonglyphs.h"
+
+#include <QPainter>
+
+#include <iterator>
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    const QPainterPath &ButtonGlyphs::contextHelpPath()
+    {
+        static const QPainterPath path = []() {
+            QPainterPath path;
+            path.moveTo(5, 6);
+            path.arcTo(QRectF(5, 3.5, 8, 5), 180, -180);
+            path.cubicTo(QPointF(12.5, 9.5), QPointF(9, 7.5), QPointF(9, 11.5));
+            return path;
+        }();
+        return path;
+    }
+
+    //__________________________________________________________________
+    void ButtonGlyphs::drawGlyph(QPainter *painter, Glyph glyph)
+    {
+        switch (glyph)
+        {
+            case Glyph::MaximizeLowerCorner:
+            painter->drawPolyline(MaximizeLowerCorner, std::size(MaximizeLowerCorner));
+            break;
+
+            case Glyph::MaximizeUpperCorner:
+            painter->drawPolyline(MaximizeUpperCorner, std::size(MaximizeUpperCorner));
+            break;
+
+            case Glyph::PinHead:
+            painter->drawPolygon(PinHead, std::size(PinHead));
+            break;
+
+            case Glyph::ChevronDown:
+            painter->drawPolyline(ChevronDown, std::size(ChevronDown));
+            break;
+
+            case Glyph::ChevronUp:
+            painter->drawPolyline(ChevronUp, std::size(ChevronUp));
+            break;
+
+            case Glyph::ChevronDownHigh:
+            painter->drawPolyline(ChevronDownHigh, std::size(ChevronDownHigh));
+            break;
+
+            case Glyph::ChevronUpHigh:
+            painter->drawPolyline(ChevronUpHigh, std::size(ChevronUpHigh));
+            break;
+
+            case Glyph::SmallChevronDownHigh:
+            painter->drawPolyline(SmallChevronDownHigh, std::size(SmallChevronDownHigh));
+            break;
+
+            case Glyph::SmallChevronDown:
+            painter->drawPolyline(SmallChevronDown, std::size(SmallChevronDown));
+            break;
+
+            case Glyph::SmallChevronUpHigh:
+            painter->drawPolyline(SmallChevronUpHigh, std::size(SmallChevronUpHigh));
+            break;
+
+            case Glyph::SmallChevronUp:
+            painter->drawPolyline(SmallChevronUp, std::size(SmallChevronUp));
+            break;
+
+            case Glyph::ContextHelp:
+            painter->drawPath(contextHelpPath());
+            break;
+        }
+    }
+
+}
@@ -0,0 +1,82 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QPainterPath>
+#include <QPointF>
+
+class QPainter;
+
+namespace Breeze
+{
+
+    //* glyph outlines of the buttons, in icon coordinates
+    /**
+    The outlines are drawn by drawGlyph through the pointer and count overloads
+    of QPainter::drawPolyline and QPainter::drawPolygon, so rendering an icon
+    does not build a polygon each time.
+    */
+    namespace ButtonGlyphs
+    {
+
+        constexpr QPointF MaximizeLowerCorner[] = { {5, 8}, {5, 13}, {10, 13} };
+        constexpr QPointF MaximizeUpperCorner[] = { {8, 5}, {13, 5}, {13, 10} };
+
+        constexpr QPointF PinHead[] = { {6.5, 8.5}, {12, 3}, {15, 6}, {9.5, 11.5} };
+
+        //* shade arrows, and lower halves of the keep above and below arrows
+        constexpr QPointF ChevronDown[] = { {5, 9}, {9, 13}, {13, 9} };
+        constexpr QPointF ChevronUp[] = { {5, 13}, {9, 9}, {13, 13} };
+
+        //* upper halves of the keep above and below arrows
+        constexpr QPointF ChevronDownHigh[] = { {5, 5}, {9, 9}, {13, 5} };
+        constexpr QPointF ChevronUpHigh[] = { {5, 9}, {9, 5}, {13, 9} };
+
+        //* keep above and below arrows of macOS-style buttons
+        constexpr QPointF SmallChevronDownHigh[] = { {6, 6}, {9, 9}, {12, 6} };
+        constexpr QPointF SmallChevronDown[] = { {6, 10}, {9, 13}, {12, 10} };
+        constexpr QPointF SmallChevronUpHigh[] = { {6, 8}, {9, 5}, {12, 8} };
+        constexpr QPointF SmallChevronUp[] = { {6, 12}, {9, 9}, {12, 12} };
+
+        //* question mark of the context help button, built once
+        const QPainterPath &contextHelpPath();
+
+        //* glyphs drawn by Button::renderIcon
+        enum class Glyph
+        {
+            MaximizeLowerCorner,
+            MaximizeUpperCorner,
+            PinHead,
+            ChevronDown,
+            ChevronUp,
+            ChevronDownHigh,
+            ChevronUpHigh,
+            SmallChevronDownHigh,
+            SmallChevronDown,
+            SmallChevronUpHigh,
+            SmallChevronUp,
+            ContextHelp
+        };
+
+        //* draw a glyph with the current pen and brush of the painter
+        void drawGlyph(QPainter *painter, Glyph glyph);
+
+    }
+
+}
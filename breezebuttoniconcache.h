@@ -0,0 +1,112 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QCache>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QPointF>
+#include <QSize>
+
+namespace Breeze
+{
+
+    //* everything a rendered button icon depends on
+    struct ButtonIconKey
+    {
+        int type = 0;
+        bool checked = false;
+        bool pressed = false;
+        bool hovered = false;
+        bool inactive = false;
+        bool macOS = false;
+        qreal animationValue = 0;
+        QSize pixelSize;
+        qreal devicePixelRatio = 1;
+
+        //* subpixel part of the position of the icon, in device pixels
+        QPointF phase;
+        QRgb titleBarColor = 0;
+        QRgb foregroundColor = 0;
+        QRgb backgroundColor = 0;
+
+        bool operator==(const ButtonIconKey &other) const
+        {
+            return type == other.type
+                   && checked == other.checked
+                   && pressed == other.pressed
+                   && hovered == other.hovered
+                   && inactive == other.inactive
+                   && macOS == other.macOS
+                   && animationValue == other.animationValue
+                   && pixelSize == other.pixelSize
+                   && devicePixelRatio == other.devicePixelRatio
+                   && phase == other.phase
+                   && titleBarColor == other.titleBarColor
+                   && foregroundColor == other.foregroundColor
+                   && backgroundColor == other.backgroundColor;
+        }
+    };
+
+    inline size_t qHash(const ButtonIconKey &key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.type, key.checked, key.pressed, key.hovered, key.inactive, key.macOS,
+                          key.animationValue, key.pixelSize, key.devicePixelRatio, key.phase.x(), key.phase.y(),
+                          key.titleBarColor, key.foregroundColor, key.backgroundColor);
+    }
+
+    //* process-wide cache of rendered button icons, shared by all decorations
+    /**
+    Buttons with the same type, state, size and colors look the same in every
+    window, so each icon is rendered once and every button draws the same image.
+    It is only used from the main thread.
+    */
+    class ButtonIconCache
+    {
+
+        public:
+
+        //* singleton
+        static ButtonIconCache &self();
+
+        //* icon for given key, or a null image if it isn't cached
+        QImage icon(const ButtonIconKey &key);
+
+        //* add an icon
+        void insert(const ButtonIconKey &key, const QImage &image);
+
+        //* remove all icons
+        void clear();
+
+        private:
+
+        //* constructor
+        ButtonIconCache() = default;
+
+        //* memory the cached icons may use, in bytes
+        static constexpr qsizetype s_maxSize = 4 * 1024 * 1024;
+
+        //* cached icons, costing their size in bytes; the least recently used ones are evicted first
+        QCache<ButtonIconKey, QImage> m_icons{s_maxSize};
+
+    };
+
+}
@@ -27,6 +27,7 @@
 #include "breezebutton.h"
 
 #include "breezeboxshadowrenderer.h"
+#include "breezeshadowcache.h"
 
 #include <KDecoration3/DecorationButtonGroup>
 #include <KDecoration3/DecorationShadow>
@@ -41,11 +42,14 @@
 #include <QDBusMessage>
 #include <QDBusPendingCallWatcher>
 #include <QDBusPendingReply>
+#include <QGuiApplication>
 #include <QPainter>
 #include <QPainterPath>
+#include <QScreen>
 #include <QTextStream>
 #include <QTimer>
 
+#include <algorithm>
 #include <cmath>
 
 K_PLUGIN_FACTORY_WITH_JSON(BreezeDecoFactory, "breezeenhanced.json", registerPlugin<Breeze::Decoration>(); registerPlugin<Breeze::Button>();)
@@ -131,6 +135,328 @@ namespace
             return s_shadowParams[3];
         }
     }
+
+    //* reduce a shadow texture to its nine-patch: corners plus one pixel wide edges
+    /**
+    The compositor anchors the corners of the texture to the window and stretches
+    the row and column going through the inner shadow rect along its edges. Fully
+    transparent outer rows and columns are therefore dropped, with the padding
+    shrunk to match, and the rows and columns next to the inner shadow rect that
+    are identical to it are merged into it. The shadow looks exactly the same.
+    */
+    Breeze::ShadowTexture compactShadowTexture(const Breeze::ShadowTexture &texture)
+    {
+        const QImage &image = texture.image;
+        if (image.isNull() || image.format() != QImage::Format_ARGB32_Premultiplied)
+            return texture;
+
+        const int width = image.width();
+        const int height = image.height();
+
+        // pixels covered by the inner shadow rect, which is not always pixel aligned
+        const QRectF &innerShadowRect = texture.innerShadowRect;
+        const int centerLeft = std::floor(innerShadowRect.left());
+        const int centerRight = std::ceil(innerShadowRect.right()) - 1;
+        const int centerTop = std::floor(innerShadowRect.top());
+        const int centerBottom = std::ceil(innerShadowRect.bottom()) - 1;
+
+        auto line = [&image](int y) {
+            return reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        };
+
+        auto isColumnEmpty = [&](int x) {
+            for (int y = 0; y < height; ++y)
+                if (line(y)[x])
+                    return false;
+            return true;
+        };
+
+        auto isRowEmpty = [&](int y) {
+            return std::all_of(line(y), line(y) + width, [](QRgb value) { return value == 0; });
+        };
+
+        auto isCenterColumn = [&](int x) {
+            for (int y = 0; y < height; ++y)
+                if (line(y)[x] != line(y)[centerLeft])
+                    return false;
+            return true;
+        };
+
+        auto isCenterRow = [&](int y) {
+            return std::equal(line(y), line(y) + width, line(centerTop));
+        };
+
+        // transparent margins
+        int left = 0;
+        while (left < centerLeft && isColumnEmpty(left))
+            ++left;
+
+        int right = width - 1;
+        while (right > centerRight && isColumnEmpty(right))
+            --right;
+
+        int top = 0;
+        while (top < centerTop && isRowEmpty(top))
+            ++top;
+
+        int bottom = height - 1;
+        while (bottom > centerBottom && isRowEmpty(bottom))
+            --bottom;
+
+        // edges, merged into a single pixel wide strip when they are uniform
+        int innerLeft = centerLeft;
+        int innerRight = centerRight;
+        const bool mergeColumns = isCenterColumn(centerRight);
+        if (mergeColumns)
+        {
+            while (innerLeft > left && isCenterColumn(innerLeft - 1))
+                --innerLeft;
+            while (innerRight < right && isCenterColumn(innerRight + 1))
+                ++innerRight;
+        }
+
+        int innerTop = centerTop;
+        int innerBottom = centerBottom;
+        const bool mergeRows = isCenterRow(centerBottom);
+        if (mergeRows)
+        {
+            while (innerTop > top && isCenterRow(innerTop - 1))
+                --innerTop;
+            while (innerBottom < bottom && isCenterRow(innerBottom + 1))
+                ++innerBottom;
+        }
+
+        // columns and rows of the original texture that are kept
+        QVector<int> columns;
+        for (int x = left; x < innerLeft; ++x)
+            columns.append(x);
+        for (int x = centerLeft; x <= (mergeColumns ? centerLeft : centerRight); ++x)
+            columns.append(x);
+        for (int x = innerRight + 1; x <= right; ++x)
+            columns.append(x);
+
+        QVector<int> rows;
+        for (int y = top; y < innerTop; ++y)
+            rows.append(y);
+        for (int y = centerTop; y <= (mergeRows ? centerTop : centerBottom); ++y)
+            rows.append(y);
+        for (int y = innerBottom + 1; y <= bottom; ++y)
+            rows.append(y);
+
+        if (columns.size() == width && rows.size() == height)
+            return texture;
+
+        QImage compacted(columns.size(), rows.size(), image.format());
+        for (int y = 0; y < rows.size(); ++y)
+        {
+            const QRgb *in = line(rows[y]);
+            QRgb *out = reinterpret_cast<QRgb *>(compacted.scanLine(y));
+            for (int x = 0; x < columns.size(); ++x)
+                out[x] = in[columns[x]];
+        }
+
+        Breeze::ShadowTexture result;
+        result.image = compacted;
+        result.padding = texture.padding - QMarginsF(left, top, width - 1 - right, height - 1 - bottom);
+        result.innerShadowRect = QRectF(
+            mergeColumns ? innerLeft - left : innerShadowRect.x() - left,
+            mergeRows ? innerTop - top : innerShadowRect.y() - top,
+            1, 1);
+        return result;
+    }
+
+    //* remove the part of a shadow texture that lies beyond given edges of the window
+    Breeze::ShadowTexture trimShadowTexture(const Breeze::ShadowTexture &texture, Qt::Edges edges)
+    {
+        if (!edges || texture.image.isNull())
+            return texture;
+
+        // the tiles of the shadow are cut around the inner rect, which must survive the trimming
+        const QSize size = texture.image.size();
+        const QRectF &inner = texture.innerShadowRect;
+        if (!QRectF(QPointF(0, 0), QSizeF(size)).contains(inner))
+            return texture;
+
+        // only whole pixels are removed, so that what remains stays in place
+        auto trimmedPixels = [edges](Qt::Edge edge, qreal padding, qreal outside) {
+            return edges.testFlag(edge) ? qMax(0, int(std::floor(qMin(padding, outside)))) : 0;
+        };
+        const int left = trimmedPixels(Qt::LeftEdge, texture.padding.left(), inner.left());
+        const int top = trimmedPixels(Qt::TopEdge, texture.padding.top(), inner.top());
+        const int right = trimmedPixels(Qt::RightEdge, texture.padding.right(), size.width() - inner.right());
+        const int bottom = trimmedPixels(Qt::BottomEdge, texture.padding.bottom(), size.height() - inner.bottom());
+
+        Breeze::ShadowTexture trimmed;
+        trimmed.image = texture.image.copy(QRect(left, top, size.width() - left - right, size.height() - top - bottom));
+        trimmed.padding = texture.padding - QMarginsF(left, top, right, bottom);
+        trimmed.innerShadowRect = inner.translated(-left, -top);
+        return trimmed;
+    }
+
+    //* screen edges that no other screen is attached to, whatever the screen
+    Qt::Edges outerScreenEdges()
+    {
+        Qt::Edges edges = Qt::LeftEdge | Qt::TopEdge | Qt::RightEdge | Qt::BottomEdge;
+
+        // screens with fractional scales can be a pixel apart, or overlap by a pixel
+        auto touches = [](int a, int b) { return qAbs(a - b) <= 1; };
+
+        const QList<QScreen *> screens = QGuiApplication::screens();
+        for (const QScreen *screen : screens)
+        {
+            const QRect geometry = screen->geometry();
+            for (const QScreen *other : screens)
+            {
+                if (other == screen)
+                    continue;
+
+                const QRect neighbor = other->geometry();
+                const bool sideBySide = neighbor.top() <= geometry.bottom() && neighbor.bottom() >= geometry.top();
+                const bool stacked = neighbor.left() <= geometry.right() && neighbor.right() >= geometry.left();
+                if (sideBySide && touches(neighbor.x() + neighbor.width(), geometry.x()))
+                    edges.setFlag(Qt::LeftEdge, false);
+                if (sideBySide && touches(geometry.x() + geometry.width(), neighbor.x()))
+                    edges.setFlag(Qt::RightEdge, false);
+                if (stacked && touches(neighbor.y() + neighbor.height(), geometry.y()))
+                    edges.setFlag(Qt::TopEdge, false);
+                if (stacked && touches(geometry.y() + geometry.height(), neighbor.y()))
+                    edges.setFlag(Qt::BottomEdge, false);
+            }
+        }
+
+        return edges;
+    }
+
+    //* shadow parameters of given settings, either a preset or the custom ones
+    CompositeShadowParams lookupShadowParams(const Breeze::InternalSettingsPtr &settings)
+    {
+        if (settings->shadowSize() != Breeze::InternalSettings::ShadowCustom)
+            return lookupShadowParams(settings->shadowSize());
+
+        // same layout as the presets: a secondary shadow half as large, pulled back by half the offset
+        const int radius = settings->shadowCustomRadius();
+        const int offset = settings->shadowCustomOffset();
+        return CompositeShadowParams(
+            QPoint(0, offset),
+            ShadowParams(QPoint(0, 0), radius, settings->shadowCustomOpacity() / 100.0),
+            ShadowParams(QPoint(0, -offset / 2), radius / 2, settings->shadowCustomSecondaryOpacity() / 100.0));
+    }
+
+    //* shadow key for given settings, without the window dependent parts
+    /**
+    The key holds the shadow parameters rather than the preset, so that presets and
+    custom shadows with the same parameters share their textures.
+    */
+    Breeze::ShadowKey lookupShadowKey(const Breeze::InternalSettingsPtr &settings)
+    {
+        const CompositeShadowParams params = lookupShadowParams(settings);
+
+        Breeze::ShadowKey key;
+        key.radius = params.shadow1.radius;
+        key.offset = params.offset.y();
+        key.primaryOpacity = qRound(params.shadow1.opacity * 100);
+        key.secondaryOpacity = qRound(params.shadow2.opacity * 100);
+        key.strength = settings->shadowStrength();
+        key.color = settings->shadowColor().rgba();
+        return key;
+    }
+
+    //* shadow parameters of given key
+    CompositeShadowParams lookupShadowParams(const Breeze::ShadowKey &key)
+    {
+        if (key.radius == 0)
+            return CompositeShadowParams();
+
+        return CompositeShadowParams(
+            QPoint(0, key.offset),
+            ShadowParams(QPoint(0, 0), key.radius, key.primaryOpacity / 100.0),
+            ShadowParams(QPoint(0, -key.offset / 2), key.radius / 2, key.secondaryOpacity / 100.0));
+    }
+
+    Breeze::ShadowTexture renderShadowTexture(const Breeze::ShadowKey &key)
+    {
+        using Breeze::BoxShadowRenderer;
+        namespace Metrics = Breeze::Metrics;
+
+        const CompositeShadowParams params = lookupShadowParams(key);
+        if (params.isNone())
+            return {};
+
+        auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
+            QColor c(color);
+            c.setAlphaF(opacity);
+            return c;
+        };
+
+        const QColor shadowColor = QColor::fromRgba(key.color);
+
+        const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
+            .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
+
+        BoxShadowRenderer shadowRenderer;
+        shadowRenderer.setBorderRadius(key.cornerRadius + 0.5);
+        shadowRenderer.setBoxSize(boxSize);
+
+        const qreal strength = static_cast<qreal>(key.strength) / 255.0 * (key.active ? 1.0 : 0.5);
+        shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
+            withOpacity(shadowColor, params.shadow1.opacity * strength));
+        shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
+            withOpacity(shadowColor, params.shadow2.opacity * strength));
+
+        // the blurred masks do not depend on the color and strength, so only tint them if they are cached
+        BoxShadowRenderer::Masks masks;
+        if (!Breeze::ShadowCache::self().findMasks(key, masks))
+        {
+            masks = shadowRenderer.renderMasks();
+            Breeze::ShadowCache::self().insertMasks(key, masks);
+        }
+
+        QImage shadowTexture = shadowRenderer.render(masks);
+
+        QPainter painter(&shadowTexture);
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        const QRectF outerRect = shadowTexture.rect();
+
+        QRectF boxRect(QPointF(0, 0), boxSize);
+        boxRect.moveCenter(outerRect.center());
+
+        // Mask out inner rect.
+        const QMarginsF padding = QMarginsF(
+            boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
+            boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
+            outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
+            outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
+        const QRectF innerRect = outerRect - padding;
+        // Push the shadow slightly under the window, which helps avoiding glitches with fractional scaling
+        // TODO fix this more properly
+        //innerRect.adjust(2, 2, -2, -2);
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
+        painter.drawRoundedRect(
+            innerRect,
+            key.cornerRadius + 0.5,
+            key.cornerRadius + 0.5);
+
+        // Draw outline.
+        painter.setPen(withOpacity(shadowColor, 0.2 * strength));
+        painter.setBrush(Qt::NoBrush);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.drawRoundedRect(
+            innerRect,
+            key.cornerRadius - 0.5,
+            key.cornerRadius - 0.5);
+
+        painter.end();
+
+        Breeze::ShadowTexture texture;
+        texture.image = shadowTexture;
+        texture.padding = padding;
+        texture.innerShadowRect = QRectF(outerRect.center(), QSizeF(1, 1));
+        return trimShadowTexture(compactShadowTexture(texture), Qt::Edges(key.trimmedEdges));
+    }
 }
 
 namespace Breeze
@@ -141,17 +467,15 @@ namespace Breeze
 
     //________________________________________________________________
     static int g_sDecoCount = 0;
-    static int g_shadowSizeEnum = InternalSettings::ShadowLarge;
-    static int g_shadowStrength = 255;
-    static QColor g_shadowColor = Qt::black;
-    static std::shared_ptr<KDecoration3::DecorationShadow> g_sShadow;
-    static std::shared_ptr<KDecoration3::DecorationShadow> g_sShadowInactive;
 
     //________________________________________________________________
     Decoration::Decoration(QObject *parent, const QVariantList &args)
         : KDecoration3::Decoration(parent, args)
     {
         g_sDecoCount++;
+
+        // the shadows are in use again
+        ShadowCache::self().cancelClear();
     }
 
     //________________________________________________________________
@@ -159,9 +483,8 @@ namespace Breeze
     {
         g_sDecoCount--;
         if (g_sDecoCount == 0) {
-            // last deco destroyed, clean up shadow
-            g_sShadow.reset();
-            g_sShadowInactive.reset();
+            // last deco destroyed, clean up shadows unless a new one shows up soon
+            ShadowCache::self().scheduleClear(SettingsProvider::self()->defaultSettings()->shadowRetention());
         }
     }
 
@@ -222,6 +545,21 @@ namespace Breeze
         });
 
         connect(w, &KDecoration3::DecoratedWindow::activeChanged, this, &Decoration::updateActiveState);
+        connect(w, &KDecoration3::DecoratedWindow::paletteChanged, this, [this]() {
+            // the color scheme has changed
+            updateButtonPalette();
+            update();
+        });
+        connect(w, &KDecoration3::DecoratedWindow::shadedChanged, this, &Decoration::updateButtonPalette);
+        // maximizedChanged always comes along with one of these
+        connect(w, &KDecoration3::DecoratedWindow::maximizedHorizontallyChanged, this, &Decoration::updateShadowDelayed);
+        connect(w, &KDecoration3::DecoratedWindow::maximizedVerticallyChanged, this, &Decoration::updateShadowDelayed);
+        connect(w, &KDecoration3::DecoratedWindow::adjacentScreenEdgesChanged, this, &Decoration::updateShadowDelayed);
+        connect(qGuiApp, &QGuiApplication::screenAdded, this, &Decoration::updateShadowDelayed);
+        connect(qGuiApp, &QGuiApplication::screenRemoved, this, &Decoration::updateShadowDelayed);
+        connect(&ShadowCache::self(), &ShadowCache::shadowReady, this, [this](const ShadowKey &key) {
+            if (key == shadowKey()) updateShadow();
+        });
         connect(this, &KDecoration3::Decoration::bordersChanged, this, &Decoration::updateTitleBar);
         connect(w, &KDecoration3::DecoratedWindow::adjacentScreenEdgesChanged, this, &Decoration::updateTitleBar);
         connect(w, &KDecoration3::DecoratedWindow::widthChanged, this, &Decoration::updateTitleBar);
@@ -249,6 +587,7 @@ namespace Breeze
 
         createButtons();
         updateShadow();
+        warmUpShadows();
 
         return true;
     }
@@ -269,10 +608,59 @@ namespace Breeze
     //________________________________________________________________
     void Decoration::updateActiveState()
     {
+        updateButtonPalette();
         updateShadow(); // active and inactive shadows are different
         update();
     }
 
+    //________________________________________________________________
+    void Decoration::updateButtonPalette()
+    {
+        const auto w = window();
+        ButtonPalette &palette = m_buttonPalette;
+
+        palette.active = w->isActive();
+        palette.titleBar = titleBarColor();
+        palette.font = fontColor();
+        palette.warning = w->color(ColorGroup::Warning, ColorRole::Foreground);
+        palette.warningHovered = palette.warning.lighter();
+
+        const bool light = qGray(palette.titleBar.rgb()) > 100;
+        palette.light = light;
+
+        int gray = qGray(palette.titleBar.rgb());
+        if (gray <= 200) {
+            gray += 55;
+            gray = qMax(gray, 115);
+        }
+        else gray -= 45;
+        palette.inactive = QColor(gray, gray, gray);
+
+        const int inactiveSymbol = gray > 127 ? gray - 127 : gray + 128;
+        palette.inactiveSymbol = QColor(inactiveSymbol, inactiveSymbol, inactiveSymbol);
+        palette.symbol = light ? QColor(250, 250, 250) : QColor(40, 40, 40);
+
+        palette.pressed[ButtonPalette::Close] = light ? QColor(254, 73, 66) : QColor(240, 77, 80);
+        palette.pressed[ButtonPalette::Maximize] = light ? QColor(7, 201, 33) : QColor(101, 188, 34);
+        palette.pressed[ButtonPalette::MaximizeChecked] = QColor(0, 188, 154);
+        palette.pressed[ButtonPalette::Minimize] = light ? QColor(233, 160, 13) : QColor(227, 185, 59);
+        palette.pressed[ButtonPalette::ApplicationMenu] = light ? QColor(220, 124, 64) : QColor(240, 139, 96);
+        palette.pressed[ButtonPalette::Other] = light ? QColor(83, 121, 170) : QColor(110, 136, 180);
+
+        palette.hovered[ButtonPalette::Close] = light ? QColor(254, 95, 87) : QColor(240, 96, 97);
+        palette.hovered[ButtonPalette::Maximize] = light ? QColor(39, 201, 63) : QColor(116, 188, 64);
+        palette.hovered[ButtonPalette::MaximizeChecked] = QColor(64, 188, 168);
+        palette.hovered[ButtonPalette::Minimize] = light ? QColor(233, 172, 41) : QColor(227, 191, 78);
+        palette.hovered[ButtonPalette::ApplicationMenu] = light ? QColor(220, 124, 64) : QColor(240, 139, 96);
+        palette.hovered[ButtonPalette::Other] = light ? QColor(98, 141, 200) : QColor(128, 157, 210);
+
+        palette.pressedFill = light ? QColor(0, 0, 0, 190) : QColor(255, 255, 255, 210);
+        palette.hoveredFill = light ? QColor(0, 0, 0, 165) : QColor(255, 255, 255, 180);
+
+        for (int frame = 0; frame <= ButtonPalette::AnimationFrames; ++frame)
+            palette.fontToTitleBar[frame] = KColorUtils::mix(palette.font, palette.titleBar, qreal(frame) / ButtonPalette::AnimationFrames);
+    }
+
     //________________________________________________________________
     qreal Decoration::borderSize(bool bottom, qreal scale) const
     {
@@ -336,6 +724,9 @@ namespace Breeze
 
         setScaledCornerRadius();
 
+        // button colors depend on whether the title bar is hidden
+        updateButtonPalette();
+
         // borders
         recalculateBorders();
 
@@ -836,97 +1227,103 @@ namespace Breeze
 
     }
 
+    //________________________________________________________________
+    void Decoration::updateShadowDelayed()
+    {
+        // maximizing changes several window states in a row; update the shadow once, after the last one
+        if (m_shadowUpdatePending)
+            return;
+
+        m_shadowUpdatePending = true;
+        QTimer::singleShot(0, this, [this]() {
+            m_shadowUpdatePending = false;
+            updateShadow();
+        });
+    }
+
     //________________________________________________________________
     void Decoration::updateShadow()
     {
-        const auto w = window();
-        auto &shadow = w->isActive() ? g_sShadow : g_sShadowInactive;
+        const ShadowKey key = shadowKey();
 
-        if (!shadow
-            || g_shadowSizeEnum != m_internalSettings->shadowSize()
-            || g_shadowStrength != m_internalSettings->shadowStrength()
-            || g_shadowColor != m_internalSettings->shadowColor())
+        // maximized windows, or windows against all screen edges, have no visible shadow
+        const Qt::Edges allEdges = Qt::LeftEdge | Qt::TopEdge | Qt::RightEdge | Qt::BottomEdge;
+        if (lookupShadowParams(key).isNone() || isMaximized() || key.trimmedEdges == allEdges.toInt())
         {
-            g_shadowSizeEnum = m_internalSettings->shadowSize();
-            g_shadowStrength = m_internalSettings->shadowStrength();
-            g_shadowColor = m_internalSettings->shadowColor();
-
-            const CompositeShadowParams params = lookupShadowParams(g_shadowSizeEnum);
-            if (params.isNone()) {
-                g_sShadow.reset();
-                g_sShadowInactive.reset();
-                setShadow(shadow);
-                return;
-            }
+            setShadow(std::shared_ptr<KDecoration3::DecorationShadow>());
+            return;
+        }
 
-            auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
-                QColor c(color);
-                c.setAlphaF(opacity);
-                return c;
-            };
-
-            const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
-                .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
-
-            BoxShadowRenderer shadowRenderer;
-            shadowRenderer.setBorderRadius(m_scaledCornerRadius + 0.5);
-            shadowRenderer.setBoxSize(boxSize);
-
-            const qreal strength = static_cast<qreal>(g_shadowStrength) / 255.0 * (w->isActive() ? 1.0 : 0.5);
-            shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
-                withOpacity(g_shadowColor, params.shadow1.opacity * strength));
-            shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
-                withOpacity(g_shadowColor, params.shadow2.opacity * strength));
-
-            QImage shadowTexture = shadowRenderer.render();
-
-            QPainter painter(&shadowTexture);
-            painter.setRenderHint(QPainter::Antialiasing);
-
-            const QRectF outerRect = shadowTexture.rect();
-
-            QRectF boxRect(QPointF(0, 0), boxSize);
-            boxRect.moveCenter(outerRect.center());
-
-            // Mask out inner rect.
-            const QMarginsF padding = QMarginsF(
-                boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
-                boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
-                outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
-                outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
-            const QRectF innerRect = outerRect - padding;
-            // Push the shadow slightly under the window, which helps avoiding glitches with fractional scaling
-            // TODO fix this more properly
-            //innerRect.adjust(2, 2, -2, -2);
-
-            painter.setPen(Qt::NoPen);
-            painter.setBrush(Qt::black);
-            painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-            painter.drawRoundedRect(
-                innerRect,
-                m_scaledCornerRadius + 0.5,
-                m_scaledCornerRadius + 0.5);
-
-            // Draw outline.
-            painter.setPen(withOpacity(g_shadowColor, 0.2 * strength));
-            painter.setBrush(Qt::NoBrush);
-            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-            painter.drawRoundedRect(
-                innerRect,
-                m_scaledCornerRadius - 0.5,
-                m_scaledCornerRadius - 0.5);
-
-            painter.end();
-
-            shadow = std::make_shared<KDecoration3::DecorationShadow>();
-            shadow->setPadding(padding);
-            shadow->setInnerShadowRect(QRectF(outerRect.center(), QSizeF(1, 1)));
-            shadow->setShadow(shadowTexture);
+        auto shadow = ShadowCache::self().shadow(key);
+        if (!shadow)
+        {
+            // load or render it on a worker thread, and keep showing the current shadow until it is ready
+            ShadowCache::self().render(key, renderShadowTexture);
+            return;
         }
 
         setShadow(shadow);
     }
 
+    //________________________________________________________________
+    void Decoration::warmUpShadows() const
+    {
+        // started by the first decorated window rather than when the plugin is loaded, and only once
+        static bool warmedUp = false;
+        if (warmedUp)
+            return;
+        warmedUp = true;
+
+        if (lookupShadowParams(m_internalSettings).isNone())
+            return;
+
+        // the shadows only depend on the scale of each screen through the snapped corner radius, see setScaledCornerRadius
+        const qreal cornerRadius = Metrics::Frame_FrameRadius * settings()->smallSpacing();
+        QList<qreal> cornerRadii = {m_scaledCornerRadius};
+        for (const QScreen *screen : QGuiApplication::screens())
+        {
+            const qreal snapped = KDecoration3::snapToPixelGrid(cornerRadius, screen->devicePixelRatio());
+            if (!cornerRadii.contains(snapped))
+                cornerRadii.append(snapped);
+        }
+
+        // windows that are not tiled, active or not
+        for (const qreal snappedCornerRadius : std::as_const(cornerRadii))
+        {
+            for (const bool active : {true, false})
+            {
+                ShadowKey key = lookupShadowKey(m_internalSettings);
+                key.cornerRadius = snappedCornerRadius;
+                key.active = active;
+
+                if (!ShadowCache::self().shadow(key))
+                    ShadowCache::self().render(key, renderShadowTexture);
+            }
+        }
+    }
+
+    //________________________________________________________________
+    ShadowKey Decoration::shadowKey() const
+    {
+        const auto w = window();
+
+        ShadowKey key = lookupShadowKey(m_internalSettings);
+        key.cornerRadius = m_scaledCornerRadius;
+        key.active = w->isActive();
+
+        // the shadow is trimmed against the screen edges the window is tiled to, unless another
+        // screen is attached there and would show it. The decoration does not know its screen,
+        // so an edge is only trimmed if it is an outer edge of every screen
+        const Qt::Edges outerEdges = outerScreenEdges();
+        Qt::Edges edges;
+        edges.setFlag(Qt::LeftEdge, isLeftEdge() && outerEdges.testFlag(Qt::LeftEdge));
+        edges.setFlag(Qt::TopEdge, isTopEdge() && outerEdges.testFlag(Qt::TopEdge));
+        edges.setFlag(Qt::RightEdge, isRightEdge() && outerEdges.testFlag(Qt::RightEdge));
+        edges.setFlag(Qt::BottomEdge, isBottomEdge() && outerEdges.testFlag(Qt::BottomEdge));
+        key.trimmedEdges = edges.toInt();
+        return key;
+    }
+
     //________________________________________________________________
     void Decoration::setScaledCornerRadius()
     {
@@ -941,6 +1338,9 @@ namespace Breeze
     {
         setScaledCornerRadius();
         recalculateBorders();
+
+        // the corner radius, hence the shadow, depends on the scale
+        updateShadow();
     }
 
 } // namespace
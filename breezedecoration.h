@@ -23,6 +23,7 @@
 
 #include "breeze.h"
 #include "breezesettings.h"
+#include "breezeshadowcache.h"
 
 #include <KDecoration3/DecoratedWindow>
 #include <KDecoration3/Decoration>
@@ -40,6 +41,47 @@ namespace KDecoration3
 
 namespace Breeze
 {
+
+    //* colors of the buttons of a decoration
+    /**
+    They only change with the active state, the color scheme and the settings,
+    so they are computed then rather than on every paint of every button.
+    */
+    struct ButtonPalette
+    {
+        //* number of hover animation frames, for which blended colors are precomputed
+        static constexpr int AnimationFrames = 16;
+
+        //* macOS-style buttons with their own colors
+        enum Kind { Close, Maximize, MaximizeChecked, Minimize, ApplicationMenu, Other, KindCount };
+
+        bool active = false;
+
+        //* whether the title bar is light
+        bool light = false;
+
+        QColor titleBar;
+        QColor font;
+        QColor warning;
+        QColor warningHovered;
+
+        //* macOS style: fill and symbol of inactive buttons, symbol of the others
+        QColor inactive;
+        QColor inactiveSymbol;
+        QColor symbol;
+
+        //* macOS style: fills of pressed and of hovered buttons, by kind
+        QColor pressed[KindCount];
+        QColor hovered[KindCount];
+
+        //* Breeze style: fills of pressed buttons, and of hovered or checked ones
+        QColor pressedFill;
+        QColor hoveredFill;
+
+        //* font color blended into the title bar color, for each hover animation frame
+        QColor fontToTitleBar[AnimationFrames + 1];
+    };
+
     class Decoration : public KDecoration3::Decoration
     {
         Q_OBJECT
@@ -69,6 +111,10 @@ namespace Breeze
         //@{
         QColor titleBarColor() const;
         QColor fontColor() const;
+
+        //* button colors, for the current active state
+        const ButtonPalette &buttonPalette() const
+        { return m_buttonPalette; }
         //@}
 
         //*@name maximization modes
@@ -94,6 +140,7 @@ namespace Breeze
         void resetBlurRegion();
         void updateButtonsGeometry();
         void updateButtonsGeometryDelayed();
+        void updateShadowDelayed();
         void updateTitleBar();
         void updateActiveState();
         void updateScale();
@@ -106,6 +153,13 @@ namespace Breeze
         void createButtons();
         void paintTitleBar(QPainter *painter, const QRectF &repaintRegion);
         void updateShadow();
+        void updateButtonPalette();
+
+        //* everything the shadow of this decoration depends on
+        ShadowKey shadowKey() const;
+
+        //* render the shadows the next windows are likely to need on a worker thread, once per process
+        void warmUpShadows() const;
 
         void setScaledCornerRadius();
 
@@ -131,6 +185,11 @@ namespace Breeze
 
         //*frame corner radius, scaled according to DPI
         qreal m_scaledCornerRadius = 3;
+
+        //* a delayed shadow update is queued
+        bool m_shadowUpdatePending = false;
+
+        ButtonPalette m_buttonPalette;
     };
 
     bool Decoration::hasBorders() const
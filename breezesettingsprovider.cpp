@@ -20,6 +20,7 @@
 
 #include "breezesettingsprovider.h"
 
+#include "breezebuttoniconcache.h"
 #include "breezeexceptionlist.h"
 
 //#include <KWindowInfo>
@@ -66,6 +67,9 @@ namespace Breeze
         exceptions.readConfig( m_config );
         m_exceptions = exceptions.get();
 
+        // icons rendered with the previous settings are not drawn anymore
+        ButtonIconCache::self().clear();
+
     }
 
     //__________________________________________________________________
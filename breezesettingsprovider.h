@@ -48,6 +48,10 @@ namespace Breeze
         //* internal settings for given decoration
         InternalSettingsPtr internalSettings(Decoration *) const;
 
+        //* settings of windows that match no exception
+        InternalSettingsPtr defaultSettings() const
+        { return m_defaultSettings; }
+
         public Q_SLOTS:
 
         //* reconfigure
@@ -0,0 +1,426 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezeshadowcache.h"
+
+#include "breezeboxshadowrenderer.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+
+namespace
+{
+    //* identifies shadow cache files
+    constexpr quint32 s_fileMagic = 0x42455348;
+
+    //* version of the cache file format and of the shadow pipeline in Decoration
+    //* it must be increased whenever a change affects the shadow textures
+    constexpr quint32 s_fileVersion = 8;
+
+    struct FileHeader
+    {
+        quint32 magic;
+        quint32 fileVersion;
+        quint32 rendererVersion;
+        qint32 radius;
+        qint32 offset;
+        qint32 primaryOpacity;
+        qint32 secondaryOpacity;
+        qint32 strength;
+        quint32 color;
+        double cornerRadius;
+        quint32 active;
+        qint32 trimmedEdges;
+        qint32 width;
+        qint32 height;
+        qint32 bytesPerLine;
+        double padding[4];
+        double innerShadowRect[4];
+    };
+
+    //* image data follows the header, suitably aligned
+    constexpr qint64 s_dataOffset = (sizeof(FileHeader) + 15) & ~qint64(15);
+
+    //* total size of the cache files that are kept, the least recently used ones are removed first
+    constexpr qint64 s_maxDiskCacheSize = 32 * 1024 * 1024;
+
+    //* cache files that have not been used for that many days are removed
+    constexpr int s_maxDiskCacheAge = 30;
+
+    QString cacheDirectory()
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+               + QStringLiteral("/breezeenhanced/shadows");
+    }
+
+    QString cacheFilePath(const Breeze::ShadowKey &key)
+    {
+        return cacheDirectory()
+               + QLatin1Char('/')
+               + QString::number(qHash(key), 16)
+               + QStringLiteral(".shadow");
+    }
+
+    //* the part of a key that the blurred masks depend on
+    Breeze::ShadowKey geometryKey(const Breeze::ShadowKey &key)
+    {
+        Breeze::ShadowKey geometry = key;
+        geometry.primaryOpacity = 0;
+        geometry.secondaryOpacity = 0;
+        geometry.strength = 0;
+        geometry.color = 0;
+        geometry.active = true;
+        geometry.trimmedEdges = 0;
+        return geometry;
+    }
+
+    //* unmaps and closes the file once the image using its data is destroyed
+    void closeMappedFile(void *file)
+    {
+        delete static_cast<QFile *>(file);
+    }
+}
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    ShadowCache &ShadowCache::self()
+    {
+        static ShadowCache cache;
+        return cache;
+    }
+
+    //__________________________________________________________________
+    ShadowCache::ShadowCache()
+    {
+        m_clearTimer.setSingleShot(true);
+        connect(&m_clearTimer, &QTimer::timeout, this, &ShadowCache::clear);
+
+        // once per session, off the main thread
+        m_threadPool.start([this]() { pruneDiskCache(); });
+    }
+
+    //__________________________________________________________________
+    ShadowCache::~ShadowCache()
+    {
+        m_threadPool.waitForDone();
+    }
+
+    //__________________________________________________________________
+    std::shared_ptr<KDecoration3::DecorationShadow> ShadowCache::shadow(const ShadowKey &key)
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            return nullptr;
+
+        it->lastUse = ++m_useCounter;
+        return it->shadow;
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::insert(const ShadowKey &key, const std::shared_ptr<KDecoration3::DecorationShadow> &shadow)
+    {
+        Entry &entry = m_entries[key];
+        entry.shadow = shadow;
+        entry.lastUse = ++m_useCounter;
+        evict();
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::clear()
+    {
+        m_entries.clear();
+
+        QMutexLocker locker(&m_masksMutex);
+        m_masks.clear();
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::scheduleClear(int delay)
+    {
+        if (delay <= 0)
+        {
+            m_clearTimer.stop();
+            clear();
+            return;
+        }
+
+        m_clearTimer.start(delay * 1000);
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::cancelClear()
+    {
+        m_clearTimer.stop();
+    }
+
+    //__________________________________________________________________
+    bool ShadowCache::findMasks(const ShadowKey &key, BoxShadowRenderer::Masks &masks)
+    {
+        QMutexLocker locker(&m_masksMutex);
+
+        auto it = m_masks.find(geometryKey(key));
+        if (it == m_masks.end())
+            return false;
+
+        it->lastUse = ++m_maskUseCounter;
+        masks = it->masks;
+        return true;
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::insertMasks(const ShadowKey &key, const BoxShadowRenderer::Masks &masks)
+    {
+        QMutexLocker locker(&m_masksMutex);
+
+        MaskEntry &entry = m_masks[geometryKey(key)];
+        entry.masks = masks;
+        entry.lastUse = ++m_maskUseCounter;
+
+        while (m_masks.size() > s_maxMasks)
+        {
+            auto oldest = m_masks.begin();
+            for (auto it = m_masks.begin(); it != m_masks.end(); ++it)
+            {
+                if (it->lastUse < oldest->lastUse)
+                    oldest = it;
+            }
+            m_masks.erase(oldest);
+        }
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::evict()
+    {
+        // shadows held by decorations are never evicted; a use count of one means only the cache holds it
+        for (;;)
+        {
+            int unused = 0;
+            auto oldest = m_entries.end();
+            for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+            {
+                if (it->shadow.use_count() > 1) continue;
+                ++unused;
+                if (oldest == m_entries.end() || it->lastUse < oldest->lastUse)
+                    oldest = it;
+            }
+
+            if (unused <= s_maxUnused) return;
+            m_entries.erase(oldest);
+        }
+    }
+
+    //__________________________________________________________________
+    bool ShadowCache::loadTexture(const ShadowKey &key, ShadowTexture &texture) const
+    {
+        auto file = std::make_unique<QFile>(cacheFilePath(key));
+        if (!file->open(QIODevice::ReadOnly))
+            return false;
+
+        // truncated, it can never be used
+        if (file->size() < s_dataOffset)
+        {
+            file->remove();
+            return false;
+        }
+
+        const uchar *data = file->map(0, file->size());
+        if (!data)
+            return false;
+
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        // written by a different version, it can never be used
+        if (header.magic != s_fileMagic
+            || header.fileVersion != s_fileVersion
+            || header.rendererVersion != BoxShadowRenderer::Version)
+        {
+            file->remove();
+            return false;
+        }
+
+        // a hash collision
+        if (header.radius != key.radius
+            || header.offset != key.offset
+            || header.primaryOpacity != key.primaryOpacity
+            || header.secondaryOpacity != key.secondaryOpacity
+            || header.strength != key.strength
+            || header.color != key.color
+            || header.cornerRadius != key.cornerRadius
+            || header.active != quint32(key.active)
+            || header.trimmedEdges != key.trimmedEdges)
+        {
+            return false;
+        }
+
+        // corrupted
+        if (header.width <= 0 || header.height <= 0
+            || header.bytesPerLine < qint64(4) * header.width
+            || file->size() - s_dataOffset < qint64(header.bytesPerLine) * header.height)
+        {
+            file->remove();
+            return false;
+        }
+
+        // pruneDiskCache keeps the most recently used files
+        file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+        // the image uses the mapped data directly; the file is closed along with it
+        QFile *mappedFile = file.release();
+        texture.image = QImage(data + s_dataOffset, header.width, header.height, header.bytesPerLine,
+                               QImage::Format_ARGB32_Premultiplied, closeMappedFile, mappedFile);
+        texture.padding = QMarginsF(header.padding[0], header.padding[1], header.padding[2], header.padding[3]);
+        texture.innerShadowRect = QRectF(header.innerShadowRect[0], header.innerShadowRect[1],
+                                         header.innerShadowRect[2], header.innerShadowRect[3]);
+        return true;
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::saveTexture(const ShadowKey &key, const ShadowTexture &texture) const
+    {
+        if (texture.image.isNull())
+            return;
+
+        const QString path = cacheFilePath(key);
+        if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+            return;
+
+        const QImage image = texture.image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+        FileHeader header = {};
+        header.magic = s_fileMagic;
+        header.fileVersion = s_fileVersion;
+        header.rendererVersion = BoxShadowRenderer::Version;
+        header.radius = key.radius;
+        header.offset = key.offset;
+        header.primaryOpacity = key.primaryOpacity;
+        header.secondaryOpacity = key.secondaryOpacity;
+        header.strength = key.strength;
+        header.color = key.color;
+        header.cornerRadius = key.cornerRadius;
+        header.active = key.active;
+        header.trimmedEdges = key.trimmedEdges;
+        header.width = image.width();
+        header.height = image.height();
+        header.bytesPerLine = image.bytesPerLine();
+        header.padding[0] = texture.padding.left();
+        header.padding[1] = texture.padding.top();
+        header.padding[2] = texture.padding.right();
+        header.padding[3] = texture.padding.bottom();
+        header.innerShadowRect[0] = texture.innerShadowRect.x();
+        header.innerShadowRect[1] = texture.innerShadowRect.y();
+        header.innerShadowRect[2] = texture.innerShadowRect.width();
+        header.innerShadowRect[3] = texture.innerShadowRect.height();
+
+        QByteArray headerData(s_dataOffset, 0);
+        std::memcpy(headerData.data(), &header, sizeof(header));
+
+        // written atomically, so that a crash never leaves a truncated file behind
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        file.write(headerData);
+        file.write(reinterpret_cast<const char *>(image.constBits()), image.sizeInBytes());
+        file.commit();
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::pruneDiskCache() const
+    {
+        QDir dir(cacheDirectory());
+        if (!dir.mkpath(QStringLiteral(".")))
+            return;
+
+        const QStringList filters = {QStringLiteral("*.shadow")};
+
+        // files of other versions are removed all at once, rather than one by one as they fail to load
+        const QByteArray version = QByteArray::number(s_fileVersion) + ' ' + QByteArray::number(BoxShadowRenderer::Version);
+        const QString versionPath = dir.filePath(QStringLiteral("version"));
+
+        QFile versionFile(versionPath);
+        if (!versionFile.open(QIODevice::ReadOnly) || versionFile.readAll().trimmed() != version)
+        {
+            for (const QString &name : dir.entryList(filters, QDir::Files))
+                dir.remove(name);
+
+            QSaveFile file(versionPath);
+            if (file.open(QIODevice::WriteOnly))
+            {
+                file.write(version);
+                file.commit();
+            }
+        }
+
+        // loadTexture touches the files it uses, so the newest files are the most recently used
+        const QDateTime oldest = QDateTime::currentDateTime().addDays(-s_maxDiskCacheAge);
+        qint64 size = 0;
+        for (const QFileInfo &info : dir.entryInfoList(filters, QDir::Files, QDir::Time))
+        {
+            size += info.size();
+            if (size > s_maxDiskCacheSize || info.lastModified() < oldest)
+                dir.remove(info.fileName());
+        }
+    }
+
+    //__________________________________________________________________
+    void ShadowCache::render(const ShadowKey &key, const TextureRenderer &renderer)
+    {
+        if (m_pending.contains(key))
+            return;
+        m_pending.insert(key);
+
+        m_threadPool.start([this, key, renderer]()
+        {
+            // reuse the texture of an earlier session if possible
+            ShadowTexture texture;
+            if (!loadTexture(key, texture))
+            {
+                texture = renderer(key);
+                saveTexture(key, texture);
+            }
+
+            // decoration shadows are only created and handed out on the main thread
+            QMetaObject::invokeMethod(this, [this, key, texture]()
+            {
+                m_pending.remove(key);
+                insert(key, createShadow(texture));
+                Q_EMIT shadowReady(key);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    //__________________________________________________________________
+    std::shared_ptr<KDecoration3::DecorationShadow> ShadowCache::createShadow(const ShadowTexture &texture)
+    {
+        auto shadow = std::make_shared<KDecoration3::DecorationShadow>();
+        shadow->setPadding(texture.padding);
+        shadow->setInnerShadowRect(texture.innerShadowRect);
+        shadow->setShadow(texture.image);
+        return shadow;
+    }
+
+}
@@ -0,0 +1,214 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "breezeboxshadowrenderer.h"
+
+#include <KDecoration3/DecorationShadow>
+
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QMarginsF>
+#include <QMutex>
+#include <QObject>
+#include <QRectF>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <functional>
+#include <memory>
+
+namespace Breeze
+{
+
+    //* everything a shadow texture depends on
+    /**
+    Shadows are rendered in logical pixels and scaled by the compositor, so the
+    output scale only matters through the corner radius, which is snapped to its
+    pixel grid. Outputs with different scales share the textures whenever their
+    corner radius is the same.
+    */
+    struct ShadowKey
+    {
+        //* blur radius and vertical offset of the main shadow, opacities of both shadows in percent
+        int radius = 0;
+        int offset = 0;
+        int primaryOpacity = 0;
+        int secondaryOpacity = 0;
+
+        int strength = 0;
+        QRgb color = 0;
+        qreal cornerRadius = 0;
+        bool active = true;
+
+        //* screen edges against which the shadow is trimmed, as Qt::Edges
+        int trimmedEdges = 0;
+
+        bool operator==(const ShadowKey &other) const
+        {
+            return radius == other.radius
+                   && offset == other.offset
+                   && primaryOpacity == other.primaryOpacity
+                   && secondaryOpacity == other.secondaryOpacity
+                   && strength == other.strength
+                   && color == other.color
+                   && cornerRadius == other.cornerRadius
+                   && active == other.active
+                   && trimmedEdges == other.trimmedEdges;
+        }
+    };
+
+    inline size_t qHash(const ShadowKey &key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.radius, key.offset, key.primaryOpacity, key.secondaryOpacity, key.strength, key.color, key.cornerRadius, key.active, key.trimmedEdges);
+    }
+
+    //* a rendered shadow, with its geometry
+    struct ShadowTexture
+    {
+        QImage image;
+        QMarginsF padding;
+        QRectF innerShadowRect;
+    };
+
+    //* process-wide cache of shadows, shared by all decorations
+    class ShadowCache : public QObject
+    {
+
+        Q_OBJECT
+
+        public:
+
+        //* renders the texture for a key; called on a worker thread
+        using TextureRenderer = std::function<ShadowTexture(const ShadowKey &)>;
+
+        //* singleton
+        static ShadowCache &self();
+
+        //* destructor
+        ~ShadowCache() override;
+
+        //* shadow for given key, or nullptr if it isn't cached
+        std::shared_ptr<KDecoration3::DecorationShadow> shadow(const ShadowKey &key);
+
+        //* add a shadow
+        void insert(const ShadowKey &key, const std::shared_ptr<KDecoration3::DecorationShadow> &shadow);
+
+        //* remove all shadows
+        void clear();
+
+        //* remove all shadows after given delay, in seconds, unless cancelClear is called
+        void scheduleClear(int delay);
+
+        //* keep the shadows after all
+        void cancelClear();
+
+        //*@name blurred masks, shared by keys that only differ by color, opacity, strength or active state
+        //* they are used from the worker threads, hence thread safe
+        //@{
+
+        //* masks for the geometry of given key, or false if they aren't cached
+        bool findMasks(const ShadowKey &key, BoxShadowRenderer::Masks &masks);
+
+        //* add masks for the geometry of given key
+        void insertMasks(const ShadowKey &key, const BoxShadowRenderer::Masks &masks);
+
+        //@}
+
+        //* load a shadow from the disk cache, or render it, on a worker thread, unless it is already pending
+        /** shadowReady is emitted once the shadow is in the cache */
+        void render(const ShadowKey &key, const TextureRenderer &renderer);
+
+        //* create a shadow from a texture
+        static std::shared_ptr<KDecoration3::DecorationShadow> createShadow(const ShadowTexture &texture);
+
+        Q_SIGNALS:
+
+        //* a shadow rendered on a worker thread has been added
+        void shadowReady(const Breeze::ShadowKey &key);
+
+        private:
+
+        //* constructor
+        ShadowCache();
+
+        //* remove the least recently used shadows that no decoration holds
+        void evict();
+
+        //*@name disk cache, only used from the worker threads
+        //@{
+
+        //* load a texture that an earlier session has saved to the disk cache
+        bool loadTexture(const ShadowKey &key, ShadowTexture &texture) const;
+
+        //* save a texture to the disk cache, for later sessions
+        void saveTexture(const ShadowKey &key, const ShadowTexture &texture) const;
+
+        //* remove the disk cache files of other versions, and the least recently used ones beyond the size and age limits
+        void pruneDiskCache() const;
+
+        //@}
+
+        struct Entry
+        {
+            std::shared_ptr<KDecoration3::DecorationShadow> shadow;
+            quint64 lastUse = 0;
+        };
+
+        //* cached shadows
+        QHash<ShadowKey, Entry> m_entries;
+
+        //* incremented on each access, for finding the least recently used entries
+        quint64 m_useCounter = 0;
+
+        struct MaskEntry
+        {
+            BoxShadowRenderer::Masks masks;
+            quint64 lastUse = 0;
+        };
+
+        //* blurred masks, by geometry
+        QHash<ShadowKey, MaskEntry> m_masks;
+
+        //* incremented on each access to the masks
+        quint64 m_maskUseCounter = 0;
+
+        //* protects the masks
+        QMutex m_masksMutex;
+
+        //* number of blurred masks that are kept
+        static constexpr int s_maxMasks = 4;
+
+        //* shadows being rendered on a worker thread
+        QSet<ShadowKey> m_pending;
+
+        //* delays clear
+        QTimer m_clearTimer;
+
+        //* worker threads; shadows must not be rendered while the plugin is being unloaded
+        QThreadPool m_threadPool;
+
+        //* number of shadows that are kept when no decoration holds them
+        static constexpr int s_maxUnused = 8;
+
+    };
+
+}
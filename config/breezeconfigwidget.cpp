@@ -70,8 +70,14 @@ namespace Breeze
 
         // track shadows changes
         connect(m_ui.shadowSize, SIGNAL(currentIndexChanged(int)), SLOT(updateChanged()));
+        connect(m_ui.shadowCustomRadius, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
+        connect(m_ui.shadowCustomOffset, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
+        connect(m_ui.shadowCustomOpacity, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
+        connect(m_ui.shadowCustomSecondaryOpacity, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
+        connect(m_ui.shadowSize, SIGNAL(currentIndexChanged(int)), SLOT(updateShadowCustomState()));
         connect(m_ui.shadowStrength, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
         connect(m_ui.shadowColor, &KColorButton::changed, this, &ConfigWidget::updateChanged);
+        connect(m_ui.shadowRetention, SIGNAL(valueChanged(int)), SLOT(updateChanged()));
 
         // track exception changes
         connect(m_ui.exceptions, &ExceptionListWidget::changed, this, &ConfigWidget::updateChanged);
@@ -128,13 +134,19 @@ namespace Breeze
         m_ui.italicCheckBox->setChecked(f.italic());
 
         // load shadows
-        if(m_internalSettings->shadowSize() <= InternalSettings::ShadowVeryLarge)
+        if(m_internalSettings->shadowSize() <= InternalSettings::ShadowCustom)
             m_ui.shadowSize->setCurrentIndex(m_internalSettings->shadowSize());
         else
             m_ui.shadowSize->setCurrentIndex(InternalSettings::ShadowLarge);
 
         m_ui.shadowStrength->setValue(qRound(qreal(m_internalSettings->shadowStrength()*100)/255));
         m_ui.shadowColor->setColor(m_internalSettings->shadowColor());
+        m_ui.shadowRetention->setValue(m_internalSettings->shadowRetention());
+        m_ui.shadowCustomRadius->setValue(m_internalSettings->shadowCustomRadius());
+        m_ui.shadowCustomOffset->setValue(m_internalSettings->shadowCustomOffset());
+        m_ui.shadowCustomOpacity->setValue(m_internalSettings->shadowCustomOpacity());
+        m_ui.shadowCustomSecondaryOpacity->setValue(m_internalSettings->shadowCustomSecondaryOpacity());
+        updateShadowCustomState();
 
         // load exceptions
         ExceptionList exceptions;
@@ -193,6 +205,11 @@ namespace Breeze
         m_internalSettings->setShadowSize(m_ui.shadowSize->currentIndex());
         m_internalSettings->setShadowStrength(qRound( qreal(m_ui.shadowStrength->value()*255)/100));
         m_internalSettings->setShadowColor(m_ui.shadowColor->color());
+        m_internalSettings->setShadowRetention(m_ui.shadowRetention->value());
+        m_internalSettings->setShadowCustomRadius(m_ui.shadowCustomRadius->value());
+        m_internalSettings->setShadowCustomOffset(m_ui.shadowCustomOffset->value());
+        m_internalSettings->setShadowCustomOpacity(m_ui.shadowCustomOpacity->value());
+        m_internalSettings->setShadowCustomSecondaryOpacity(m_ui.shadowCustomSecondaryOpacity->value());
 
         // save configuration
         m_internalSettings->save();
@@ -272,9 +289,24 @@ namespace Breeze
         m_ui.shadowSize->setCurrentIndex(m_internalSettings->shadowSize());
         m_ui.shadowStrength->setValue(qRound(qreal(m_internalSettings->shadowStrength()*100)/255));
         m_ui.shadowColor->setColor(m_internalSettings->shadowColor());
+        m_ui.shadowRetention->setValue(m_internalSettings->shadowRetention());
+        m_ui.shadowCustomRadius->setValue(m_internalSettings->shadowCustomRadius());
+        m_ui.shadowCustomOffset->setValue(m_internalSettings->shadowCustomOffset());
+        m_ui.shadowCustomOpacity->setValue(m_internalSettings->shadowCustomOpacity());
+        m_ui.shadowCustomSecondaryOpacity->setValue(m_internalSettings->shadowCustomSecondaryOpacity());
 
     }
 
+    //_______________________________________________
+    void ConfigWidget::updateShadowCustomState()
+    {
+        const bool custom = m_ui.shadowSize->currentIndex() == InternalSettings::ShadowCustom;
+        m_ui.shadowCustomRadius->setEnabled(custom);
+        m_ui.shadowCustomOffset->setEnabled(custom);
+        m_ui.shadowCustomOpacity->setEnabled(custom);
+        m_ui.shadowCustomSecondaryOpacity->setEnabled(custom);
+    }
+
     //_______________________________________________
     void ConfigWidget::updateChanged()
     {
@@ -325,6 +357,16 @@ namespace Breeze
             modified = true;
         else if (m_ui.shadowColor->color() != m_internalSettings->shadowColor())
             modified = true;
+        else if (m_ui.shadowRetention->value() != m_internalSettings->shadowRetention())
+            modified = true;
+        else if (m_ui.shadowCustomRadius->value() != m_internalSettings->shadowCustomRadius())
+            modified = true;
+        else if (m_ui.shadowCustomOffset->value() != m_internalSettings->shadowCustomOffset())
+            modified = true;
+        else if (m_ui.shadowCustomOpacity->value() != m_internalSettings->shadowCustomOpacity())
+            modified = true;
+        else if (m_ui.shadowCustomSecondaryOpacity->value() != m_internalSettings->shadowCustomSecondaryOpacity())
+            modified = true;
 
         // exceptions
         else if (m_ui.exceptions->isChanged())
@@ -67,6 +67,9 @@ namespace Breeze
         //* update changed state
         virtual void updateChanged();
 
+        //* enable the custom shadow parameters only for the custom shadow
+        void updateShadowCustomState();
+
         private:
 
         //* ui
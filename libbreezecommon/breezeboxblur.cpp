@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2018 Vlad Zagorodniy <vladzzag@gmail.com>
+ *
+ * The box blur implementation is based on AlphaBoxBlur from Firefox.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "breezeboxblur_p.h"
+
+// Qt
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BREEZE_BOXBLUR_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Breeze
+{
+/**
+ * Compute box filter parameters.
+ *
+ * @param radius The blur radius.
+ * @returns Parameters for three box filters.
+ **/
+std::array<BoxLobes, 3> computeLobes(int radius)
+{
+    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
+    const int z = blurRadius / 3;
+
+    int major;
+    int minor;
+    int final;
+
+    switch (blurRadius % 3) {
+    case 0:
+        major = z;
+        minor = z;
+        final = z;
+        break;
+
+    case 1:
+        major = z + 1;
+        minor = z;
+        final = z;
+        break;
+
+    case 2:
+        major = z + 1;
+        minor = z;
+        final = z + 1;
+        break;
+
+    default:
+        Q_UNREACHABLE();
+        break;
+    }
+
+    Q_ASSERT(major + minor + final == blurRadius);
+
+    return {{{major, minor}, {minor, major}, {final, final}}};
+}
+
+#ifdef BREEZE_BOXBLUR_X86
+__attribute__((target("sse2"))) static inline __m128i mulLo32Sse2(__m128i a, __m128i b)
+{
+    // SSE2 has no 32-bit multiplication; multiply even and odd lanes separately.
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2"))) static void boxBlurLanesSse2(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const __m128i reciprocal = _mm_set1_epi32((1 << 24) / boxSize);
+
+    const __m128i *in = reinterpret_cast<const __m128i *>(src);
+    __m128i *out = reinterpret_cast<__m128i *>(dst);
+
+    const __m128i firstLo = _mm_loadu_si128(in);
+    const __m128i firstHi = _mm_loadu_si128(in + 1);
+    const __m128i lastLo = _mm_loadu_si128(in + 2 * (length - 1));
+    const __m128i lastHi = _mm_loadu_si128(in + 2 * (length - 1) + 1);
+
+    const __m128i leftLobe = _mm_set1_epi32(lobes.left);
+    __m128i sumLo = _mm_add_epi32(_mm_set1_epi32((boxSize + 1) / 2), mulLo32Sse2(firstLo, leftLobe));
+    __m128i sumHi = _mm_add_epi32(_mm_set1_epi32((boxSize + 1) / 2), mulLo32Sse2(firstHi, leftLobe));
+
+    int right = 0;
+    for (; right < boxSize - lobes.left; ++right) {
+        sumLo = _mm_add_epi32(sumLo, _mm_loadu_si128(in + 2 * right));
+        sumHi = _mm_add_epi32(sumHi, _mm_loadu_si128(in + 2 * right + 1));
+    }
+
+    int left = 0;
+    int i = 0;
+    for (; right < boxSize; ++right, ++i) {
+        _mm_storeu_si128(out + 2 * i, _mm_srli_epi32(mulLo32Sse2(sumLo, reciprocal), 24));
+        _mm_storeu_si128(out + 2 * i + 1, _mm_srli_epi32(mulLo32Sse2(sumHi, reciprocal), 24));
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(_mm_loadu_si128(in + 2 * right), firstLo));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(_mm_loadu_si128(in + 2 * right + 1), firstHi));
+    }
+
+    for (; right < length; ++right, ++left, ++i) {
+        _mm_storeu_si128(out + 2 * i, _mm_srli_epi32(mulLo32Sse2(sumLo, reciprocal), 24));
+        _mm_storeu_si128(out + 2 * i + 1, _mm_srli_epi32(mulLo32Sse2(sumHi, reciprocal), 24));
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(_mm_loadu_si128(in + 2 * right), _mm_loadu_si128(in + 2 * left)));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(_mm_loadu_si128(in + 2 * right + 1), _mm_loadu_si128(in + 2 * left + 1)));
+    }
+
+    for (; i < length; ++left, ++i) {
+        _mm_storeu_si128(out + 2 * i, _mm_srli_epi32(mulLo32Sse2(sumLo, reciprocal), 24));
+        _mm_storeu_si128(out + 2 * i + 1, _mm_srli_epi32(mulLo32Sse2(sumHi, reciprocal), 24));
+        sumLo = _mm_add_epi32(sumLo, _mm_sub_epi32(lastLo, _mm_loadu_si128(in + 2 * left)));
+        sumHi = _mm_add_epi32(sumHi, _mm_sub_epi32(lastHi, _mm_loadu_si128(in + 2 * left + 1)));
+    }
+}
+
+__attribute__((target("avx2"))) static void boxBlurLanesAvx2(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const __m256i reciprocal = _mm256_set1_epi32((1 << 24) / boxSize);
+
+    const __m256i *in = reinterpret_cast<const __m256i *>(src);
+    __m256i *out = reinterpret_cast<__m256i *>(dst);
+
+    const __m256i first = _mm256_loadu_si256(in);
+    const __m256i last = _mm256_loadu_si256(in + length - 1);
+
+    __m256i sum = _mm256_add_epi32(_mm256_set1_epi32((boxSize + 1) / 2),
+                                   _mm256_mullo_epi32(first, _mm256_set1_epi32(lobes.left)));
+
+    int right = 0;
+    for (; right < boxSize - lobes.left; ++right) {
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256(in + right));
+    }
+
+    int left = 0;
+    int i = 0;
+    for (; right < boxSize; ++right, ++i) {
+        _mm256_storeu_si256(out + i, _mm256_srli_epi32(_mm256_mullo_epi32(sum, reciprocal), 24));
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(_mm256_loadu_si256(in + right), first));
+    }
+
+    for (; right < length; ++right, ++left, ++i) {
+        _mm256_storeu_si256(out + i, _mm256_srli_epi32(_mm256_mullo_epi32(sum, reciprocal), 24));
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(_mm256_loadu_si256(in + right), _mm256_loadu_si256(in + left)));
+    }
+
+    for (; i < length; ++left, ++i) {
+        _mm256_storeu_si256(out + i, _mm256_srli_epi32(_mm256_mullo_epi32(sum, reciprocal), 24));
+        sum = _mm256_add_epi32(sum, _mm256_sub_epi32(last, _mm256_loadu_si256(in + left)));
+    }
+}
+#endif
+
+BoxBlurLanesFunc boxBlurLanesFunc(BoxBlurKernel kernel)
+{
+#ifdef BREEZE_BOXBLUR_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+    case BoxBlurKernel::Sse2:
+        return __builtin_cpu_supports("sse2") ? boxBlurLanesSse2 : nullptr;
+    case BoxBlurKernel::Avx2:
+        return __builtin_cpu_supports("avx2") ? boxBlurLanesAvx2 : nullptr;
+    }
+#else
+    Q_UNUSED(kernel)
+#endif
+    return nullptr;
+}
+
+BoxBlurLanesFunc selectBoxBlurLanesFunc()
+{
+    if (BoxBlurLanesFunc kernel = boxBlurLanesFunc(BoxBlurKernel::Avx2)) {
+        return kernel;
+    }
+    return boxBlurLanesFunc(BoxBlurKernel::Sse2);
+}
+
+/**
+ * Scratch memory of the box blur.
+ *
+ * Every thread that blurs keeps its own, and reuses it from one blur to the
+ * next. The buffers only grow.
+ **/
+struct BlurScratch {
+    std::vector<uint32_t> lanes; ///< interleaved lines of the SIMD kernels
+    std::vector<uint8_t> lines; ///< lines of the scalar kernel
+    std::vector<uint8_t> tile; ///< transposed columns of the vertical pass
+};
+
+static BlurScratch &blurScratch()
+{
+    thread_local BlurScratch scratch;
+    return scratch;
+}
+
+/**
+ * Get a scratch buffer of at least the given size.
+ **/
+template<typename T>
+static inline T *scratchBuffer(std::vector<T> &buffer, size_t size)
+{
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+/**
+ * The assumed size of a cache line, in bytes.
+ **/
+static constexpr int BlurCacheLineSize = 64;
+
+/**
+ * Blur a set of parallel lines of alpha values with three box filters.
+ *
+ * @param data The first alpha value of the first line.
+ * @param length The length of each line, in pixels.
+ * @param count The number of lines.
+ * @param step The number of bytes from one alpha value of a line to the next one.
+ * @param lineStride The number of bytes from one line to the next line.
+ * @param lobes Params of the three box filters.
+ **/
+static void boxBlurLinesAlpha(uint8_t *data, int length, int count, int step, int lineStride, const std::array<BoxLobes, 3> &lobes)
+{
+    static const BoxBlurLanesFunc blurLanes = selectBoxBlurLanesFunc();
+
+    int line = 0;
+
+    if (blurLanes && count >= BlurLaneCount) {
+        const int bufferStride = length * BlurLaneCount;
+        uint32_t *buf1 = scratchBuffer(blurScratch().lanes, 2 * bufferStride);
+        uint32_t *buf2 = buf1 + bufferStride;
+
+        for (; line + BlurLaneCount <= count; line += BlurLaneCount) {
+            uint8_t *lines = data + line * lineStride;
+
+            for (int i = 0; i < length; ++i) {
+                const uint8_t *in = lines + i * step;
+                uint32_t *out = buf1 + i * BlurLaneCount;
+                for (int lane = 0; lane < BlurLaneCount; ++lane) {
+                    out[lane] = in[lane * lineStride];
+                }
+            }
+
+            blurLanes(buf1, buf2, length, lobes[0]);
+            blurLanes(buf2, buf1, length, lobes[1]);
+            blurLanes(buf1, buf2, length, lobes[2]);
+
+            for (int i = 0; i < length; ++i) {
+                const uint32_t *in = buf2 + i * BlurLaneCount;
+                uint8_t *out = lines + i * step;
+                for (int lane = 0; lane < BlurLaneCount; ++lane) {
+                    out[lane * lineStride] = in[lane];
+                }
+            }
+        }
+    }
+
+    if (line == count) {
+        return;
+    }
+
+    // Blur the remaining lines one by one with the scalar kernel.
+    uint8_t *buf1 = scratchBuffer(blurScratch().lines, 2 * length);
+    uint8_t *buf2 = buf1 + length;
+
+    for (; line < count; ++line) {
+        uint8_t *in = data + line * lineStride;
+        boxBlurRowAlpha(in, buf1, length, 1, step, lobes[0], true, false);
+        boxBlurRowAlpha(buf1, buf2, length, 1, step, lobes[1], false, false);
+        boxBlurRowAlpha(buf2, in, length, 1, step, lobes[2], false, true);
+    }
+}
+
+/**
+ * Copy a block of alpha values between an image and a transposed buffer.
+ *
+ * In the buffer, every column of the block is stored as a contiguous row.
+ *
+ * @param image The first alpha value of the block in the image.
+ * @param tile The buffer.
+ * @param columns The width of the block, in pixels.
+ * @param rows The height of the block, in pixels.
+ * @param pixelStride The number of bytes from one alpha value of the image to the next one.
+ * @param rowStride The number of bytes from one row of the image to the next row.
+ * @param toTile Whether to copy from the image to the buffer or the other way round.
+ **/
+static inline void transposeAlphaTile(uint8_t *image, uint8_t *tile, int columns, int rows, int pixelStride, int rowStride, bool toTile)
+{
+    for (int y = 0; y < rows; ++y) {
+        uint8_t *row = image + y * rowStride;
+        for (int x = 0; x < columns; ++x) {
+            if (toTile) {
+                tile[x * rows + y] = row[x * pixelStride];
+            } else {
+                row[x * pixelStride] = tile[x * rows + y];
+            }
+        }
+    }
+}
+
+/**
+ * Split a range of indices into chunks and process them on several threads.
+ *
+ * The calling thread processes the first chunk and waits for the others. A
+ * chunk for which no pool thread is free is processed by the calling thread.
+ *
+ * @param count The number of indices.
+ * @param granularity Chunks start at multiples of it.
+ * @param threadCount The maximum number of chunks.
+ * @param func Called with the first and one past the last index of each chunk.
+ **/
+template<typename Func>
+static void parallelForChunks(int count, int granularity, int threadCount, const Func &func)
+{
+    const int units = (count + granularity - 1) / granularity;
+    const int chunks = qMin(threadCount, units);
+    if (chunks <= 1) {
+        func(0, count);
+        return;
+    }
+
+    auto chunkBegin = [&](int chunk) {
+        return qMin(count, units * chunk / chunks * granularity);
+    };
+
+    QSemaphore done;
+    int started = 0;
+    for (int chunk = 1; chunk < chunks; ++chunk) {
+        const int begin = chunkBegin(chunk);
+        const int end = chunkBegin(chunk + 1);
+        const bool queued = QThreadPool::globalInstance()->tryStart([&func, &done, begin, end]() {
+            func(begin, end);
+            done.release();
+        });
+        if (queued) {
+            ++started;
+        } else {
+            func(begin, end);
+        }
+    }
+
+    func(0, chunkBegin(1));
+    done.acquire(started);
+}
+
+void boxBlurAlpha(uint8_t *origin, int width, int height, int pixelStride, int rowStride, int radius, int threadCount)
+{
+    if (radius < 2) {
+        return;
+    }
+
+    const std::array<BoxLobes, 3> lobes = computeLobes(radius);
+
+    // Blur the image in horizontal direction.
+    parallelForChunks(height, BlurLaneCount, threadCount, [&](int firstRow, int lastRow) {
+        boxBlurLinesAlpha(origin + firstRow * rowStride, width, lastRow - firstRow, pixelStride, rowStride, lobes);
+    });
+
+    // Blur the image in vertical direction. Walking down a column touches a new
+    // cache line for every pixel, so the columns are transposed tile by tile into
+    // a contiguous buffer, blurred there as rows and then transposed back.
+    const int tileWidth = qMax(BlurLaneCount, BlurCacheLineSize / pixelStride);
+    parallelForChunks(width, tileWidth, threadCount, [&](int firstColumn, int lastColumn) {
+        uint8_t *tile = scratchBuffer(blurScratch().tile, tileWidth * height);
+        for (int x = firstColumn; x < lastColumn; x += tileWidth) {
+            const int columns = qMin(tileWidth, lastColumn - x);
+            uint8_t *tileOrigin = origin + x * pixelStride;
+            transposeAlphaTile(tileOrigin, tile, columns, height, pixelStride, rowStride, true);
+            boxBlurLinesAlpha(tile, height, columns, 1, height, lobes);
+            transposeAlphaTile(tileOrigin, tile, columns, height, pixelStride, rowStride, false);
+        }
+    });
+}
+
+} // namespace Breeze
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2018 Vlad Zagorodniy <vladzzag@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// Qt
+#include <QtMath>
+
+#include <array>
+#include <cstdint>
+
+/**
+ * The box blur kernels of BoxShadowRenderer.
+ *
+ * They are internal to the library, and only declared here so that they can
+ * be tested and benchmarked.
+ **/
+namespace Breeze
+{
+inline int calculateBlurRadius(qreal stdDev)
+{
+    // See https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement
+    const qreal gaussianScaleFactor = (3.0 * qSqrt(2.0 * M_PI) / 4.0) * 1.5;
+    return qMax(2, qFloor(stdDev * gaussianScaleFactor + 0.5));
+}
+
+inline qreal calculateBlurStdDev(int radius)
+{
+    // See https://www.w3.org/TR/css-backgrounds-3/#shadow-blur
+    return radius * 0.5;
+}
+
+struct BoxLobes {
+    int left; ///< how many pixels sample to the left
+    int right; ///< how many pixels sample to the right
+};
+
+/**
+ * Compute box filter parameters.
+ *
+ * @param radius The blur radius.
+ * @returns Parameters for three box filters.
+ **/
+std::array<BoxLobes, 3> computeLobes(int radius);
+
+/**
+ * Process a row with a box filter.
+ *
+ * @param src The start of the row.
+ * @param dst The destination.
+ * @param width The width of the row, in pixels.
+ * @param horizontalStride The number of bytes from one alpha value to the
+ *    next alpha value.
+ * @param verticalStride The number of bytes from one row to the next row.
+ * @param lobes Params of the box filter.
+ * @param transposeInput Whether the input is transposed.
+ * @param transposeOutput Whether the output should be transposed.
+ **/
+inline void boxBlurRowAlpha(const uint8_t *src,
+                            uint8_t *dst,
+                            int width,
+                            int horizontalStride,
+                            int verticalStride,
+                            const BoxLobes &lobes,
+                            bool transposeInput,
+                            bool transposeOutput)
+{
+    const int inputStep = transposeInput ? verticalStride : horizontalStride;
+    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
+
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const int reciprocal = (1 << 24) / boxSize;
+
+    uint32_t alphaSum = (boxSize + 1) / 2;
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    const uint8_t firstValue = src[0];
+    const uint8_t lastValue = src[(width - 1) * inputStep];
+
+    alphaSum += firstValue * lobes.left;
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
+    while (right < initEnd) {
+        alphaSum += *right;
+        right += inputStep;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * inputStep;
+    while (right < leftEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - firstValue;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *centerEnd = src + width * inputStep;
+    while (right < centerEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - *left;
+        left += inputStep;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *rightEnd = dst + width * outputStep;
+    while (out < rightEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += lastValue - *left;
+        left += inputStep;
+        out += outputStep;
+    }
+}
+
+/**
+ * The number of lines the vectorized kernels blur at once.
+ *
+ * The lines are interleaved in a scratch buffer, so that the n-th alpha values
+ * of all lines are adjacent 32-bit integers.
+ **/
+constexpr int BlurLaneCount = 8;
+
+/**
+ * Process BlurLaneCount interleaved lines with a box filter.
+ *
+ * This is a vectorized equivalent of boxBlurRowAlpha(), and its results must
+ * be bit-exact with it.
+ *
+ * @param src The interleaved input lines.
+ * @param dst The interleaved output lines.
+ * @param length The length of each line, in pixels.
+ * @param lobes Params of the box filter.
+ **/
+using BoxBlurLanesFunc = void (*)(const uint32_t *src, uint32_t *dst, int length, const BoxLobes &lobes);
+
+/**
+ * The vectorized kernels.
+ **/
+enum class BoxBlurKernel {
+    Sse2,
+    Avx2,
+};
+
+/**
+ * Get a given vectorized kernel.
+ *
+ * @returns The kernel, or nullptr if it is not built in or the CPU does not support it.
+ **/
+BoxBlurLanesFunc boxBlurLanesFunc(BoxBlurKernel kernel);
+
+/**
+ * Pick the fastest vectorized kernel supported by the CPU.
+ *
+ * @returns The kernel, or nullptr if only the scalar path is available.
+ **/
+BoxBlurLanesFunc selectBoxBlurLanesFunc();
+
+/**
+ * The number of alpha values from which a blur is split across threads.
+ *
+ * A blur costs about 4 ns per alpha value, a 256x256 block about 250 us,
+ * while waking up a pool thread and waiting for it costs from a few to tens
+ * of microseconds for each of the two passes. Below that size, which covers
+ * every shadow preset at scale 1, the gain does not outweigh the hand over.
+ * See autotests/boxblurbenchmark.cpp.
+ **/
+constexpr qint64 ParallelBlurThreshold = 256 * 256;
+
+/**
+ * Blur a block of alpha values with three box filters.
+ *
+ * The rows are blurred first, then the columns. Either pass is split into
+ * bands of lines that are blurred on threads of the global thread pool.
+ *
+ * @param origin The first alpha value of the block.
+ * @param width The width of the block, in pixels.
+ * @param height The height of the block, in pixels.
+ * @param pixelStride The number of bytes from one alpha value to the next one.
+ * @param rowStride The number of bytes from one row to the next row.
+ * @param radius The blur radius.
+ * @param threadCount The maximum number of threads to use, including the calling one.
+ **/
+void boxBlurAlpha(uint8_t *origin, int width, int height, int pixelStride, int rowStride, int radius, int threadCount);
+
+} // namespace Breeze
@@ -20,150 +20,53 @@
 
 // own
 #include "breezeboxshadowrenderer.h"
+#include "breezeboxblur_p.h"
 
 // Qt
 #include <QPainter>
+#include <QThread>
 #include <QtMath>
 
-namespace Breeze
-{
-static inline int calculateBlurRadius(qreal stdDev)
-{
-    // See https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement
-    const qreal gaussianScaleFactor = (3.0 * qSqrt(2.0 * M_PI) / 4.0) * 1.5;
-    return qMax(2, qFloor(stdDev * gaussianScaleFactor + 0.5));
-}
+#include <array>
+#include <vector>
 
-static inline qreal calculateBlurStdDev(int radius)
+namespace Breeze
 {
-    // See https://www.w3.org/TR/css-backgrounds-3/#shadow-blur
-    return radius * 0.5;
-}
-
 static inline QSize calculateBlurExtent(int radius)
 {
     const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
     return QSize(blurRadius, blurRadius);
 }
 
-struct BoxLobes {
-    int left; ///< how many pixels sample to the left
-    int right; ///< how many pixels sample to the right
-};
-
 /**
- * Compute box filter parameters.
+ * Compute the offset of the alpha value within a pixel.
  *
- * @param radius The blur radius.
- * @returns Parameters for three box filters.
+ * @param image The image, either in an alpha-only or a 32-bit ARGB format.
  **/
-static QVector<BoxLobes> computeLobes(int radius)
+static inline int alphaOffset(const QImage &image)
 {
-    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
-    const int z = blurRadius / 3;
-
-    int major;
-    int minor;
-    int final;
-
-    switch (blurRadius % 3) {
-    case 0:
-        major = z;
-        minor = z;
-        final = z;
-        break;
-
-    case 1:
-        major = z + 1;
-        minor = z;
-        final = z;
-        break;
-
-    case 2:
-        major = z + 1;
-        minor = z;
-        final = z + 1;
-        break;
-
-    default:
-        Q_UNREACHABLE();
-        break;
+    if (image.format() == QImage::Format_Alpha8) {
+        return 0;
     }
-
-    Q_ASSERT(major + minor + final == blurRadius);
-
-    return {{major, minor}, {minor, major}, {final, final}};
+    return QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
 }
 
 /**
- * Process a row with a box filter.
+ * Scratch memory of the shadow rendering.
  *
- * @param src The start of the row.
- * @param dst The destination.
- * @param width The width of the row, in pixels.
- * @param horizontalStride The number of bytes from one alpha value to the
- *    next alpha value.
- * @param verticalStride The number of bytes from one row to the next row.
- * @param lobes Params of the box filter.
- * @param transposeInput Whether the input is transposed.
- * @param transposeOutput Whether the output should be transposed.
+ * Every thread that renders shadows keeps its own, and reuses it from one
+ * shadow to the next, so that regenerating many shadows in a row does not
+ * allocate temporary buffers over and over. The buffers only grow.
  **/
-static inline void boxBlurRowAlpha(const uint8_t *src,
-                                   uint8_t *dst,
-                                   int width,
-                                   int horizontalStride,
-                                   int verticalStride,
-                                   const BoxLobes &lobes,
-                                   bool transposeInput,
-                                   bool transposeOutput)
-{
-    const int inputStep = transposeInput ? verticalStride : horizontalStride;
-    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
-
-    const int boxSize = lobes.left + 1 + lobes.right;
-    const int reciprocal = (1 << 24) / boxSize;
-
-    uint32_t alphaSum = (boxSize + 1) / 2;
-
-    const uint8_t *left = src;
-    const uint8_t *right = src;
-    uint8_t *out = dst;
-
-    const uint8_t firstValue = src[0];
-    const uint8_t lastValue = src[(width - 1) * inputStep];
-
-    alphaSum += firstValue * lobes.left;
-
-    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
-    while (right < initEnd) {
-        alphaSum += *right;
-        right += inputStep;
-    }
-
-    const uint8_t *leftEnd = src + boxSize * inputStep;
-    while (right < leftEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - firstValue;
-        right += inputStep;
-        out += outputStep;
-    }
-
-    const uint8_t *centerEnd = src + width * inputStep;
-    while (right < centerEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - *left;
-        left += inputStep;
-        right += inputStep;
-        out += outputStep;
-    }
+struct ShadowScratch {
+    std::vector<std::array<QRgb, 256>> tints; ///< tint tables of the composition
+    QImage boxMask; ///< the rasterized box
+};
 
-    const uint8_t *rightEnd = dst + width * outputStep;
-    while (out < rightEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += lastValue - *left;
-        left += inputStep;
-        out += outputStep;
-    }
+static ShadowScratch &shadowScratch()
+{
+    thread_local ShadowScratch scratch;
+    return scratch;
 }
 
 /**
@@ -176,40 +79,16 @@ static inline void boxBlurRowAlpha(const uint8_t *src,
  **/
 static inline void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {})
 {
-    if (radius < 2) {
-        return;
-    }
-
-    const QVector<BoxLobes> lobes = computeLobes(radius);
-
     const QRect blurRect = rect.isNull() ? image.rect() : rect;
-
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int width = blurRect.width();
-    const int height = blurRect.height();
-    const int rowStride = image.bytesPerLine();
     const int pixelStride = image.depth() >> 3;
 
-    const int bufferStride = qMax(width, height) * pixelStride;
-    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t>> buf(new uint8_t[2 * bufferStride]);
-    uint8_t *buf1 = buf.data();
-    uint8_t *buf2 = buf1 + bufferStride;
-
-    // Blur the image in horizontal direction.
-    for (int i = 0; i < height; ++i) {
-        uint8_t *row = image.scanLine(blurRect.y() + i) + blurRect.x() * pixelStride + alphaOffset;
-        boxBlurRowAlpha(row, buf1, width, pixelStride, rowStride, lobes[0], false, false);
-        boxBlurRowAlpha(buf1, buf2, width, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, row, width, pixelStride, rowStride, lobes[2], false, false);
-    }
+    uint8_t *origin = image.scanLine(blurRect.y()) + blurRect.x() * pixelStride + alphaOffset(image);
 
-    // Blur the image in vertical direction.
-    for (int i = 0; i < width; ++i) {
-        uint8_t *column = image.scanLine(blurRect.y()) + (blurRect.x() + i) * pixelStride + alphaOffset;
-        boxBlurRowAlpha(column, buf1, height, pixelStride, rowStride, lobes[0], true, false);
-        boxBlurRowAlpha(buf1, buf2, height, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, column, height, pixelStride, rowStride, lobes[2], false, true);
-    }
+    // Rows, and columns, are blurred independently of each other, so large
+    // images are split into bands that are blurred on several threads.
+    const bool parallel = qint64(blurRect.width()) * blurRect.height() >= ParallelBlurThreshold;
+
+    boxBlurAlpha(origin, blurRect.width(), blurRect.height(), pixelStride, image.bytesPerLine(), radius, parallel ? QThread::idealThreadCount() : 1);
 }
 
 static inline void mirrorTopLeftQuadrant(QImage &image)
@@ -220,11 +99,11 @@ static inline void mirrorTopLeftQuadrant(QImage &image)
     const int centerX = qCeil(width * 0.5);
     const int centerY = qCeil(height * 0.5);
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
+    const int offset = alphaOffset(image);
     const int stride = image.depth() >> 3;
 
     for (int y = 0; y < centerY; ++y) {
-        uint8_t *in = image.scanLine(y) + alphaOffset;
+        uint8_t *in = image.scanLine(y) + offset;
         uint8_t *out = in + (width - 1) * stride;
 
         for (int x = 0; x < centerX; ++x, in += stride, out -= stride) {
@@ -233,8 +112,8 @@ static inline void mirrorTopLeftQuadrant(QImage &image)
     }
 
     for (int y = 0; y < centerY; ++y) {
-        const uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = image.scanLine(width - y - 1) + alphaOffset;
+        const uint8_t *in = image.scanLine(y) + offset;
+        uint8_t *out = image.scanLine(width - y - 1) + offset;
 
         for (int x = 0; x < width; ++x, in += stride, out += stride) {
             *out = *in;
@@ -242,49 +121,122 @@ static inline void mirrorTopLeftQuadrant(QImage &image)
     }
 }
 
-static void renderShadow(QPainter *painter, const QRectF &rect, qreal borderRadius, const QPointF &offset, double radius, const QColor &color)
+/**
+ * Multiply the four channels of a pixel by an alpha value.
+ *
+ * Same as BYTE_MUL() in Qt, so compositing matches QPainter.
+ **/
+static inline QRgb byteMul(QRgb x, uint a)
 {
-    const qreal dpr = painter->device()->devicePixelRatioF();
-    const QSize inflation = calculateBlurExtent(radius);
-    const QSize pixelSize = ((rect.size() + 2 * inflation) * dpr).toSize();
-    const QSizeF size = QSizeF(pixelSize) / dpr;
+    uint t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
 
-    QImage shadow(pixelSize, QImage::Format_ARGB32_Premultiplied);
-    shadow.setDevicePixelRatio(dpr);
-    shadow.fill(Qt::transparent);
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080);
+    x &= 0xff00ff00;
+
+    return x | t;
+}
+
+/**
+ * Tint shadow masks and composite them onto a canvas.
+ *
+ * All masks are blended in one pass over the canvas, in order, as if each
+ * one was painted on top of the previous ones.
+ *
+ * @param canvas The premultiplied ARGB canvas.
+ * @param masks The shadow masks.
+ * @param colors The tint of each mask.
+ **/
+static void compositeShadowMasks(QImage &canvas, const BoxShadowRenderer::Masks &masks, const QVector<QColor> &colors)
+{
+    // Premultiplied tints for every alpha value of the masks.
+    std::vector<std::array<QRgb, 256>> &tints = shadowScratch().tints;
+    tints.resize(colors.size());
+    for (int i = 0; i < colors.size(); ++i) {
+        const QRgb color = qPremultiply(colors[i].rgba());
+        for (uint a = 0; a < 256; ++a) {
+            tints[i][a] = byteMul(color, a);
+        }
+    }
+
+    for (int y = 0; y < canvas.height(); ++y) {
+        QRgb *out = reinterpret_cast<QRgb *>(canvas.scanLine(y));
+
+        for (int i = 0; i < colors.size(); ++i) {
+            const QImage &mask = masks.images[i];
+            const QPoint &origin = masks.origins[i];
+            const int maskY = y - origin.y();
+            if (maskY < 0 || maskY >= mask.height()) {
+                continue;
+            }
+
+            const uint8_t *in = mask.constScanLine(maskY) - origin.x();
+            const int begin = qMax(0, origin.x());
+            const int end = qMin(canvas.width(), origin.x() + mask.width());
+            const std::array<QRgb, 256> &tint = tints[i];
+
+            for (int x = begin; x < end; ++x) {
+                const QRgb src = tint[in[x]];
+                out[x] = src + byteMul(out[x], 255 - qAlpha(src));
+            }
+        }
+    }
+}
 
-    QRectF boxRect(QPoint(0, 0), rect.size());
-    boxRect.moveCenter(QRectF(QPoint(0, 0), size).center());
+/**
+ * Rasterize a rounded box into an alpha mask.
+ *
+ * @param image The mask. It is reallocated only if it does not have the given size.
+ * @param size The size of the mask. The box is centered in it.
+ * @param boxSize The size of the box.
+ * @param xRadius The horizontal radius of the corners of the box.
+ * @param yRadius The vertical radius of the corners of the box.
+ **/
+static void rasterizeBox(QImage &image, const QSize &size, const QSizeF &boxSize, qreal xRadius, qreal yRadius)
+{
+    if (image.size() != size || image.format() != QImage::Format_Alpha8) {
+        image = QImage(size, QImage::Format_Alpha8);
+    }
+    image.fill(0);
 
-    const qreal xRadius = 2.0 * borderRadius / boxRect.width();
-    const qreal yRadius = 2.0 * borderRadius / boxRect.height();
+    QRectF boxRect(QPoint(0, 0), boxSize);
+    boxRect.moveCenter(QRectF(QPoint(0, 0), QSizeF(size)).center());
 
-    QPainter shadowPainter;
-    shadowPainter.begin(&shadow);
-    shadowPainter.setRenderHint(QPainter::Antialiasing);
-    shadowPainter.setPen(Qt::NoPen);
-    shadowPainter.setBrush(Qt::black);
-    shadowPainter.drawRoundedRect(boxRect, xRadius, yRadius);
-    shadowPainter.end();
+    QPainter painter;
+    painter.begin(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(Qt::black);
+    painter.drawRoundedRect(boxRect, xRadius, yRadius);
+    painter.end();
+}
 
+/**
+ * Blur a box mask with box filters.
+ *
+ * @param image The alpha mask, with the box centered in it.
+ * @param radius The blur radius.
+ **/
+static void blurBoxMask(QImage &image, int radius)
+{
     // Because the shadow texture is symmetrical, that's enough to blur
     // only the top-left quadrant and then mirror it.
-    const QRect blurRect(0, 0, std::ceil(shadow.width() * 0.5), std::ceil(shadow.height() * 0.5));
-    const int scaledRadius = std::round(radius * dpr);
-    boxBlurAlpha(shadow, scaledRadius, blurRect);
-    mirrorTopLeftQuadrant(shadow);
-
-    // Give the shadow a tint of the desired color.
-    shadowPainter.begin(&shadow);
-    shadowPainter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    shadowPainter.fillRect(shadow.rect(), color);
-    shadowPainter.end();
-
-    // Actually, present the shadow.
-    QRectF shadowRect = shadow.rect();
-    shadowRect.setSize(shadowRect.size() / dpr);
-    shadowRect.moveCenter(rect.center() + offset);
-    painter->drawImage(shadowRect, shadow);
+    const QRect blurRect(0, 0, std::ceil(image.width() * 0.5), std::ceil(image.height() * 0.5));
+    boxBlurAlpha(image, radius, blurRect);
+    mirrorTopLeftQuadrant(image);
+}
+
+/**
+ * Compute the size of the mask of a shadow.
+ *
+ * @param boxSize The size of the box.
+ * @param radius The blur radius.
+ **/
+static inline QSize calculateShadowMaskSize(const QSizeF &boxSize, double radius)
+{
+    return (boxSize + 2 * calculateBlurExtent(radius)).toSize();
 }
 
 void BoxShadowRenderer::setBoxSize(const QSizeF &size)
@@ -306,28 +258,82 @@ void BoxShadowRenderer::addShadow(const QPointF &offset, double radius, const QC
     m_shadows.append(shadow);
 }
 
-QImage BoxShadowRenderer::render() const
+BoxShadowRenderer::Masks BoxShadowRenderer::renderMasks() const
 {
+    Masks masks;
     if (m_shadows.isEmpty()) {
-        return {};
+        return masks;
     }
 
     QSizeF canvasSize;
+    QSize boxMaskSize;
     for (const Shadow &shadow : std::as_const(m_shadows)) {
         canvasSize = canvasSize.expandedTo(calculateMinimumShadowTextureSize(m_boxSize, shadow.radius, shadow.offset));
+        boxMaskSize = boxMaskSize.expandedTo(calculateShadowMaskSize(m_boxSize, shadow.radius));
     }
-
-    QImage canvas(canvasSize.toSize(), QImage::Format_ARGB32_Premultiplied);
-    canvas.fill(Qt::transparent);
+    masks.canvasSize = canvasSize.toSize();
 
     QRectF boxRect(QPoint(0, 0), m_boxSize);
-    boxRect.moveCenter(QRect(QPoint(0, 0), canvas.size()).center());
+    boxRect.moveCenter(QRect(QPoint(0, 0), masks.canvasSize).center());
+
+    const qreal xRadius = 2.0 * m_borderRadius / m_boxSize.width();
+    const qreal yRadius = 2.0 * m_borderRadius / m_boxSize.height();
+
+    // The box is rasterized only once, large enough for the widest shadow, and
+    // the mask of every shadow is cut out of it before being blurred.
+    QImage &boxMask = shadowScratch().boxMask;
+    rasterizeBox(boxMask, boxMaskSize, m_boxSize, xRadius, yRadius);
+
+    masks.images.reserve(m_shadows.size());
+    masks.origins.reserve(m_shadows.size());
 
-    QPainter painter(&canvas);
     for (const Shadow &shadow : std::as_const(m_shadows)) {
-        renderShadow(&painter, boxRect, m_borderRadius, shadow.offset, shadow.radius, shadow.color);
+        const QSize maskSize = calculateShadowMaskSize(m_boxSize, shadow.radius);
+        const int radius = std::round(shadow.radius);
+
+        QImage mask;
+        // The box stays at the same subpixel position only if the cut is symmetrical.
+        const QSize margins = boxMaskSize - maskSize;
+        if (margins.width() % 2 == 0 && margins.height() % 2 == 0) {
+            mask = boxMask.copy(QRect(QPoint(margins.width() / 2, margins.height() / 2), maskSize));
+        } else {
+            rasterizeBox(mask, maskSize, m_boxSize, xRadius, yRadius);
+        }
+        blurBoxMask(mask, radius);
+
+        QRectF shadowRect(QPoint(0, 0), QSizeF(maskSize));
+        shadowRect.moveCenter(boxRect.center() + shadow.offset);
+
+        masks.images.append(mask);
+        masks.origins.append(QPoint(qRound(shadowRect.x()), qRound(shadowRect.y())));
     }
-    painter.end();
+
+    return masks;
+}
+
+QImage BoxShadowRenderer::render() const
+{
+    return render(renderMasks());
+}
+
+QImage BoxShadowRenderer::render(const Masks &masks) const
+{
+    if (m_shadows.isEmpty()) {
+        return {};
+    }
+
+    Q_ASSERT(masks.images.size() == m_shadows.size());
+
+    QImage canvas(masks.canvasSize, QImage::Format_ARGB32_Premultiplied);
+    canvas.fill(Qt::transparent);
+
+    QVector<QColor> colors;
+    colors.reserve(m_shadows.size());
+    for (const Shadow &shadow : std::as_const(m_shadows)) {
+        colors.append(shadow.color);
+    }
+
+    compositeShadowMasks(canvas, masks, colors);
 
     return canvas;
 }
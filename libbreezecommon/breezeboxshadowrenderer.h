@@ -26,6 +26,7 @@
 #include <QImage>
 #include <QPoint>
 #include <QSize>
+#include <QVector>
 
 namespace Breeze
 {
@@ -34,6 +35,14 @@ class BREEZECOMMON_EXPORT BoxShadowRenderer
 public:
     // Compiler generated constructors & destructor are fine.
 
+    /**
+     * The version of the rendering algorithm.
+     *
+     * It must be increased whenever a change affects the rendered shadows, so
+     * that textures saved by earlier versions are not reused.
+     **/
+    static constexpr int Version = 3;
+
     /**
      * Set the size of the box.
      * @param size The size of the box.
@@ -54,11 +63,37 @@ public:
      **/
     void addShadow(const QPointF &offset, double radius, const QColor &color);
 
+    /**
+     * The blurred alpha masks of the shadows, before they are tinted.
+     *
+     * They depend on the box, the border radius and the offset and radius of
+     * each shadow, but not on the colors of the shadows.
+     **/
+    struct Masks {
+        QSize canvasSize; ///< the size of the rendered shadow
+        QVector<QImage> images; ///< one mask per shadow, in Format_Alpha8
+        QVector<QPoint> origins; ///< where each mask goes in the rendered shadow
+    };
+
+    /**
+     * Render the blurred masks of the shadows.
+     **/
+    Masks renderMasks() const;
+
     /**
      * Render the shadow.
      **/
     QImage render() const;
 
+    /**
+     * Render the shadow from masks rendered earlier.
+     *
+     * Only the colors are applied, so this is much cheaper than render().
+     *
+     * @param masks The masks, rendered by a renderer with the same geometry.
+     **/
+    QImage render(const Masks &masks) const;
+
     /**
      * Calculate the minimum size of the box.
      *